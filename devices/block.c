@@ -1,9 +1,13 @@
 #include "devices/block.h"
+#include <blockstat.h>
 #include <list.h>
 #include <string.h>
 #include <stdio.h>
 #include "devices/ide.h"
+#include "devices/timer.h"
+#include "threads/interrupt.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* A block device. */
 struct block
@@ -17,8 +21,8 @@ struct block
     const struct block_operations *ops;  /* Driver operations. */
     void *aux;                          /* Extra data owned by driver. */
 
-    unsigned long long read_cnt;        /* Number of sectors read. */
-    unsigned long long write_cnt;       /* Number of sectors written. */
+    struct block_stat stat;             /* I/O statistics. */
+    block_sector_t next_sector;         /* Sector after the last request. */
   };
 
 /* List of all block devices. */
@@ -28,6 +32,11 @@ static struct list all_blocks = LIST_INITIALIZER (all_blocks);
 static struct block *block_by_role[BLOCK_ROLE_CNT];
 
 static struct block *list_elem_to_block (struct list_elem *);
+static void start_request (struct block *, block_sector_t,
+                           struct block_request *);
+static void submit_and_wait (struct block *, block_sector_t, size_t cnt,
+                             void *buffer, bool write);
+static void request_done (struct block_request *);
 
 /* Returns a human-readable name for the given block device
    TYPE. */
@@ -121,10 +130,7 @@ void
 block_read (struct block *block, block_sector_t sector, void *buffer)
 {
   check_sector (block, sector);
-  //printf("reading block\n");
-  block->ops->read (block->aux, sector, buffer);
-  //printf("after reading block\n");
-  block->read_cnt++;
+  submit_and_wait (block, sector, 1, buffer, false);
 }
 
 /* Write sector SECTOR to BLOCK from BUFFER, which must contain
@@ -137,8 +143,195 @@ block_write (struct block *block, block_sector_t sector, const void *buffer)
 {
   check_sector (block, sector);
   ASSERT (block->type != BLOCK_FOREIGN);
-  block->ops->write (block->aux, sector, buffer);
-  block->write_cnt++;
+  submit_and_wait (block, sector, 1, (void *) buffer, true);
+}
+
+/* Verifies that the CNT sectors starting at SECTOR are a valid,
+   non-empty range within BLOCK.  Panics if not. */
+static void
+check_sector_range (struct block *block, block_sector_t sector, size_t cnt)
+{
+  ASSERT (cnt > 0);
+  check_sector (block, sector);
+  if (cnt > block->size - sector)
+    PANIC ("Access past end of device %s (sector=%"PRDSNu", count=%zu, "
+           "size=%"PRDSNu")\n", block_name (block), sector, cnt,
+           block->size);
+}
+
+/* Performs CNT-sector transfer between SECTOR in BLOCK and BUFFER
+   synchronously with BLOCK's read and write operations, writing
+   if WRITE is true and reading otherwise. */
+static void
+transfer_sync (struct block *block, block_sector_t sector, size_t cnt,
+               void *buffer, bool write)
+{
+  size_t i;
+
+  if (write && block->ops->write_multi != NULL)
+    block->ops->write_multi (block->aux, sector, cnt, buffer);
+  else if (!write && block->ops->read_multi != NULL)
+    block->ops->read_multi (block->aux, sector, cnt, buffer);
+  else
+    for (i = 0; i < cnt; i++)
+      {
+        uint8_t *sector_buffer = (uint8_t *) buffer + i * BLOCK_SECTOR_SIZE;
+        if (write)
+          block->ops->write (block->aux, sector + i, sector_buffer);
+        else
+          block->ops->read (block->aux, sector + i, sector_buffer);
+      }
+}
+
+/* Reads the CNT consecutive sectors starting at SECTOR from BLOCK
+   into BUFFER, which must have room for CNT * BLOCK_SECTOR_SIZE
+   bytes.  Drivers that support it move all of the sectors with as
+   few device commands as possible.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_read_multi (struct block *block, block_sector_t sector, size_t cnt,
+                  void *buffer)
+{
+  check_sector_range (block, sector, cnt);
+  submit_and_wait (block, sector, cnt, buffer, false);
+}
+
+/* Writes the CNT consecutive sectors starting at SECTOR to BLOCK
+   from BUFFER, which must contain CNT * BLOCK_SECTOR_SIZE bytes.
+   Returns after the block device has acknowledged receiving the
+   data.
+   Internally synchronizes accesses to block devices, so external
+   per-block device locking is unneeded. */
+void
+block_write_multi (struct block *block, block_sector_t sector, size_t cnt,
+                   const void *buffer)
+{
+  check_sector_range (block, sector, cnt);
+  ASSERT (block->type != BLOCK_FOREIGN);
+  submit_and_wait (block, sector, cnt, (void *) buffer, true);
+}
+
+/* Submits request R to transfer R->cnt sectors starting at
+   SECTOR in BLOCK and returns, possibly before the transfer is
+   done.  R->done is called once it completes, from the thread
+   that carried out the transfer; it must not block on further
+   block I/O.  Devices without queueing support perform the
+   transfer before returning. */
+void
+block_submit (struct block *block, block_sector_t sector,
+              struct block_request *r)
+{
+  check_sector_range (block, sector, r->cnt);
+  ASSERT (r->done != NULL);
+  ASSERT (!r->write || block->type != BLOCK_FOREIGN);
+  start_request (block, sector, r);
+}
+
+/* Hands request R for SECTOR in BLOCK to BLOCK's driver, or
+   carries it out synchronously if the driver does not queue.
+
+   A request is charged, in full, to the device it was first
+   submitted to.  When a partition forwards a request to its disk,
+   the disk does not count it again. */
+static void
+start_request (struct block *block, block_sector_t sector,
+               struct block_request *r)
+{
+  if (r->done != request_done)
+    {
+      struct block_stat *s = &block->stat;
+      enum intr_level old_level;
+
+      old_level = intr_disable ();
+      if (sector == block->next_sector)
+        s->seq_request_cnt++;
+      block->next_sector = sector + r->cnt;
+      if (++s->queue_depth > s->max_queue_depth)
+        s->max_queue_depth = s->queue_depth;
+      intr_set_level (old_level);
+
+      r->block = block;
+      r->client_done = r->done;
+      r->done = request_done;
+      r->start = timer_cycles ();
+    }
+
+  r->sector = sector;
+  r->driver = block->aux;
+  if (block->ops->submit != NULL)
+    block->ops->submit (block->aux, r);
+  else
+    {
+      transfer_sync (block, sector, r->cnt, r->buffer, r->write);
+      r->done (r);
+    }
+}
+
+/* Completion function that the block layer puts in front of
+   every request's own.  Counts the request and its latency against
+   the device it was submitted to, then calls the submitter's
+   DONE. */
+static void
+request_done (struct block_request *r)
+{
+  struct block_stat *s = &r->block->stat;
+  uint64_t cycles = timer_cycles () - r->start;
+  long long bytes = (long long) r->cnt * BLOCK_SECTOR_SIZE;
+  uint64_t x;
+  int bucket;
+  enum intr_level old_level;
+
+  bucket = 0;
+  for (x = cycles; x > 1 && bucket < BLOCKSTAT_BUCKETS - 1; x >>= 1)
+    bucket++;
+
+  old_level = intr_disable ();
+  if (r->write)
+    {
+      s->write_cnt += r->cnt;
+      s->write_bytes += bytes;
+    }
+  else
+    {
+      s->read_cnt += r->cnt;
+      s->read_bytes += bytes;
+    }
+  s->request_cnt++;
+  s->latency[bucket]++;
+  s->latency_cycles += cycles;
+  s->queue_depth--;
+  intr_set_level (old_level);
+
+  r->done = r->client_done;
+  r->done (r);
+}
+
+/* Completion function for submit_and_wait(). */
+static void
+wake_waiter (struct block_request *r)
+{
+  sema_up (r->aux);
+}
+
+/* Transfers CNT sectors between SECTOR in BLOCK and BUFFER
+   through BLOCK's request queue and waits for the transfer to
+   finish. */
+static void
+submit_and_wait (struct block *block, block_sector_t sector, size_t cnt,
+                 void *buffer, bool write)
+{
+  struct block_request r;
+  struct semaphore done;
+
+  sema_init (&done, 0);
+  r.cnt = cnt;
+  r.buffer = buffer;
+  r.write = write;
+  r.done = wake_waiter;
+  r.aux = &done;
+  start_request (block, sector, &r);
+  sema_down (&done);
 }
 
 /* Returns the number of sectors in BLOCK. */
@@ -166,20 +359,59 @@ block_type (struct block *block)
 void
 block_print_stats (void)
 {
-  int i;
+  int i, j;
 
   for (i = 0; i < BLOCK_ROLE_CNT; i++)
     {
       struct block *block = block_by_role[i];
-      if (block != NULL)
-        {
-          printf ("%s (%s): %llu reads, %llu writes\n",
-                  block->name, block_type_name (block->type),
-                  block->read_cnt, block->write_cnt);
-        }
+      struct block_stat s;
+      long long completed;
+
+      if (block == NULL)
+        continue;
+      block_get_stat (i, &s);
+      printf ("%s (%s): %lld reads, %lld writes\n",
+              block->name, block_type_name (block->type),
+              s.read_cnt, s.write_cnt);
+      if (s.request_cnt == 0)
+        continue;
+
+      completed = 0;
+      for (j = 0; j < BLOCKSTAT_BUCKETS; j++)
+        completed += s.latency[j];
+      printf ("  %lld requests, %lld%% sequential, max queue depth %lld, "
+              "mean latency %lld cycles\n",
+              s.request_cnt, s.seq_request_cnt * 100 / s.request_cnt,
+              s.max_queue_depth,
+              completed > 0 ? s.latency_cycles / completed : 0);
+      if (completed == 0)
+        continue;
+      printf ("  latency (log2 cycles):");
+      for (j = 0; j < BLOCKSTAT_BUCKETS; j++)
+        if (s.latency[j] != 0)
+          printf (" %d:%lld", j, s.latency[j]);
+      printf ("\n");
     }
 }
 
+/* Copies the statistics of the block device assigned ROLE into
+   *STAT.  Returns true if successful, false if no device has that
+   role. */
+bool
+block_get_stat (enum block_type role, struct block_stat *stat)
+{
+  struct block *block;
+  enum intr_level old_level;
+
+  if (role >= BLOCK_ROLE_CNT || (block = block_by_role[role]) == NULL)
+    return false;
+
+  old_level = intr_disable ();
+  *stat = block->stat;
+  intr_set_level (old_level);
+  return true;
+}
+
 /* Registers a new block device with the given NAME.  If
    EXTRA_INFO is non-null, it is printed as part of a user
    message.  The block device's SIZE in sectors and its TYPE must
@@ -200,8 +432,8 @@ block_register (const char *name, enum block_type type,
   block->size = size;
   block->ops = ops;
   block->aux = aux;
-  block->read_cnt = 0;
-  block->write_cnt = 0;
+  memset (&block->stat, 0, sizeof block->stat);
+  block->next_sector = 0;
 
   printf ("%s: %'"PRDSNu" sectors (", block->name, block->size);
   print_human_readable_size ((uint64_t) block->size * BLOCK_SECTOR_SIZE);
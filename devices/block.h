@@ -3,6 +3,7 @@
 
 #include <stddef.h>
 #include <inttypes.h>
+#include <list.h>
 
 /* Size of a block device sector in bytes.
    All IDE disks use this sector size, as do most USB and SCSI
@@ -53,11 +54,44 @@ struct block *block_next (struct block *);
 block_sector_t block_size (struct block *);
 void block_read (struct block *, block_sector_t, void *);
 void block_write (struct block *, block_sector_t, const void *);
+void block_read_multi (struct block *, block_sector_t, size_t cnt, void *);
+void block_write_multi (struct block *, block_sector_t, size_t cnt,
+                        const void *);
 const char *block_name (struct block *);
 enum block_type block_type (struct block *);
 
+/* Asynchronous block I/O. */
+
+struct block_request;
+typedef void block_done_func (struct block_request *);
+
+/* A request to transfer CNT sectors, submitted with block_submit().
+   The submitter fills in the first group of members and must not
+   touch the request or its buffer again until DONE is called.
+   Requests that overlap may complete in any order. */
+struct block_request
+  {
+    size_t cnt;                 /* Number of sectors to transfer. */
+    void *buffer;               /* CNT * BLOCK_SECTOR_SIZE bytes. */
+    bool write;                 /* Write to device if true, else read. */
+    block_done_func *done;      /* Called once the transfer completes. */
+    void *aux;                  /* For use by DONE. */
+
+    /* Owned by the block layer and drivers. */
+    block_sector_t sector;      /* First sector within the device. */
+    void *driver;               /* Driver data of the device. */
+    struct list_elem elem;      /* Element in a driver's queue. */
+    struct block *block;        /* Device the request was submitted to. */
+    uint64_t start;             /* timer_cycles() at submission. */
+    block_done_func *client_done;       /* Submitter's DONE. */
+  };
+
+void block_submit (struct block *, block_sector_t, struct block_request *);
+
 /* Statistics. */
+struct block_stat;
 void block_print_stats (void);
+bool block_get_stat (enum block_type role, struct block_stat *);
 
 /* Lower-level interface to block device drivers. */
 
@@ -65,6 +99,21 @@ struct block_operations
   {
     void (*read) (void *aux, block_sector_t, void *buffer);
     void (*write) (void *aux, block_sector_t, const void *buffer);
+
+    /* Transfer CNT consecutive sectors at once.  Optional: if
+       null, the block layer falls back to one read or write
+       call per sector. */
+    void (*read_multi) (void *aux, block_sector_t, size_t cnt,
+                        void *buffer);
+    void (*write_multi) (void *aux, block_sector_t, size_t cnt,
+                         const void *buffer);
+
+    /* Queues a request and returns, calling the request's DONE
+       function once it completes.  Optional: if non-null, all
+       I/O on the device goes through it and the members above
+       may be null; otherwise the block layer performs requests
+       synchronously with the functions above. */
+    void (*submit) (void *aux, struct block_request *);
   };
 
 struct block *block_register (const char *name, enum block_type,
@@ -8,7 +8,10 @@
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
+#include "threads/palloc.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 /* The code in this file is an interface to an ATA (IDE)
    controller.  It attempts to comply to [ATA-3]. */
@@ -34,6 +37,7 @@
 #define STA_BSY 0x80            /* Busy. */
 #define STA_DRDY 0x40           /* Device Ready. */
 #define STA_DRQ 0x08            /* Data Request. */
+#define STA_ERR 0x01            /* Error. */
 
 /* Control Register bits. */
 #define CTL_SRST 0x04           /* Software Reset. */
@@ -49,6 +53,63 @@
 #define CMD_IDENTIFY_DEVICE 0xec        /* IDENTIFY DEVICE. */
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
+#define CMD_READ_MULTIPLE 0xc4          /* READ MULTIPLE. */
+#define CMD_WRITE_MULTIPLE 0xc5         /* WRITE MULTIPLE. */
+#define CMD_SET_MULTIPLE_MODE 0xc6      /* SET MULTIPLE MODE. */
+#define CMD_READ_DMA 0xc8               /* READ DMA. */
+#define CMD_WRITE_DMA 0xca              /* WRITE DMA. */
+
+/* Most sectors a single 28-bit LBA command can transfer. */
+#define MAX_SECTORS_PER_CMD 256
+
+/* Most requests merged into a single ATA command. */
+#define MAX_SEGMENTS 32
+
+/* Part of a transfer: CNT sectors at BUFFER. */
+struct segment
+  {
+    uint8_t *buffer;
+    size_t cnt;
+  };
+
+/* Bus master IDE register port addresses, relative to the
+   channel's bus master base.  See [BMIDE]. */
+#define reg_bm_command(CHANNEL) ((CHANNEL)->bm_base + 0) /* Command. */
+#define reg_bm_status(CHANNEL) ((CHANNEL)->bm_base + 2)  /* Status. */
+#define reg_bm_prdt(CHANNEL) ((CHANNEL)->bm_base + 4)    /* PRD table. */
+
+/* Bus master Command Register bits. */
+#define BM_CMD_START 0x01       /* Start bus master operation. */
+#define BM_CMD_READ 0x08        /* Transfer from disk to memory. */
+
+/* Bus master Status Register bits. */
+#define BM_STA_ERROR 0x02       /* Transfer failed (write 1 to clear). */
+#define BM_STA_INTR 0x04        /* Interrupt raised (write 1 to clear). */
+
+/* A physical region descriptor (PRD).  A bus master transfer is
+   described by a table of these, each naming a physically
+   contiguous buffer that does not cross a 64 kB boundary.  The
+   table itself must be 4-byte aligned and may not cross a 64 kB
+   boundary either. */
+struct prd
+  {
+    uint32_t addr;              /* Physical address of buffer. */
+    uint16_t size;              /* Byte count, 0 meaning 64 kB. */
+    uint16_t flags;             /* PRD_EOT on the last entry. */
+  };
+#define PRD_EOT 0x8000          /* End of table. */
+
+/* PCI configuration space access, used to locate the bus master
+   registers of the IDE controller.  See [PCI] 3.2.2.3.2. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+#define PCI_REG_ID 0x00         /* Vendor and device ID. */
+#define PCI_REG_COMMAND 0x04    /* Command register. */
+#define PCI_REG_CLASS 0x08      /* Class code and revision. */
+#define PCI_REG_BAR4 0x20       /* Base address register 4. */
+#define PCI_CMD_IO 0x0001       /* Respond to I/O space accesses. */
+#define PCI_CMD_MASTER 0x0004   /* Enable bus mastering. */
+#define PCI_CLASS_IDE 0x0101    /* Mass storage, IDE interface. */
 
 /* An ATA device. */
 struct ata_disk
@@ -57,6 +118,9 @@ struct ata_disk
     struct channel *channel;    /* Channel that disk is attached to. */
     int dev_no;                 /* Device 0 or 1 for master or slave. */
     bool is_ata;                /* Is device an ATA disk? */
+    bool dma;                   /* Use bus master DMA for transfers? */
+    int multiple;               /* Sectors per interrupt for READ/WRITE
+                                   MULTIPLE, or 0 if not enabled. */
   };
 
 /* An ATA channel (aka controller).
@@ -72,6 +136,21 @@ struct channel
                                    any interrupt would be spurious. */
     struct semaphore completion_wait;   /* Up'd by interrupt handler. */
 
+    uint16_t bm_base;           /* Bus master base I/O port, or 0 if none. */
+    struct prd *prd;            /* PRD table for bus master transfers. */
+    uint8_t bm_status;          /* Bus master status at last interrupt. */
+
+    struct lock queue_lock;     /* Protects the members below. */
+    struct list queue;          /* Pending requests, by queue key. */
+    uint32_t head;              /* Queue key just past the last transfer. */
+    struct condition queue_nonempty;    /* Signaled when a request arrives. */
+
+    /* Statistics. */
+    bool busy;                  /* Is the worker carrying out requests? */
+    long long busy_ticks;       /* Timer ticks during which busy was set. */
+    long long request_cnt;      /* Requests completed. */
+    long long command_cnt;      /* ATA commands issued for them. */
+
     struct ata_disk devices[2];     /* The devices on this channel. */
   };
 
@@ -79,29 +158,45 @@ struct channel
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Timer tick at which the channel workers started. */
+static int64_t start_ticks;
+
 static struct block_operations ide_operations;
 
 static void reset_channel (struct channel *);
 static bool check_device_type (struct ata_disk *);
 static void identify_ata_device (struct ata_disk *);
+static void set_multiple_mode (struct ata_disk *, int sectors);
 
-static void select_sector (struct ata_disk *, block_sector_t);
+static void select_sector (struct ata_disk *, block_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
 
+static void pio_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          const struct segment *, bool write);
+
+static uint16_t find_bus_master (void);
+static bool use_dma (const struct ata_disk *, const struct segment *,
+                     size_t seg_cnt);
+static void dma_transfer (struct ata_disk *, block_sector_t, size_t cnt,
+                          const struct segment *, size_t seg_cnt,
+                          bool write);
+
 static void wait_until_idle (const struct ata_disk *);
 static bool wait_while_busy (const struct ata_disk *);
 static void select_device (const struct ata_disk *);
 static void select_device_wait (const struct ata_disk *);
 
 static void interrupt_handler (struct intr_frame *);
+static thread_func channel_worker NO_RETURN;
 
 /* Initialize the disk subsystem and detect disks. */
 void
 ide_init (void) 
 {
   size_t chan_no;
+  uint16_t bm_base = find_bus_master ();
 
   for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++)
     {
@@ -126,6 +221,28 @@ ide_init (void)
       lock_init (&c->lock);
       c->expecting_interrupt = false;
       sema_init (&c->completion_wait, 0);
+      lock_init (&c->queue_lock);
+      list_init (&c->queue);
+      c->head = 0;
+      cond_init (&c->queue_nonempty);
+      c->busy = false;
+      c->busy_ticks = c->request_cnt = c->command_cnt = 0;
+
+      /* Set up bus master DMA, if the controller supports it.
+         Each channel's registers occupy 8 ports.  A page-sized,
+         page-aligned PRD table never crosses a 64 kB boundary. */
+      c->bm_base = 0;
+      c->prd = NULL;
+      if (bm_base != 0)
+        {
+          c->prd = palloc_get_page (PAL_ZERO);
+          if (c->prd != NULL)
+            {
+              c->bm_base = bm_base + chan_no * 8;
+              printf ("%s: bus master DMA at port %#"PRIx16"\n",
+                      c->name, c->bm_base);
+            }
+        }
  
       /* Initialize devices. */
       for (dev_no = 0; dev_no < 2; dev_no++)
@@ -136,6 +253,8 @@ ide_init (void)
           d->channel = c;
           d->dev_no = dev_no;
           d->is_ata = false;
+          d->dma = false;
+          d->multiple = 0;
         }
 
       /* Register interrupt handler. */
@@ -148,11 +267,49 @@ ide_init (void)
       if (check_device_type (&c->devices[0]))
         check_device_type (&c->devices[1]);
 
+      /* Start the thread that carries out the channel's
+         requests.  This must precede identify_ata_device(),
+         which registers the disk and reads its partition
+         table through the request queue. */
+      if (thread_create (c->name, PRI_DEFAULT, channel_worker, c)
+          == TID_ERROR)
+        PANIC ("%s: cannot create worker thread", c->name);
+
       /* Read hard disk identity information. */
       for (dev_no = 0; dev_no < 2; dev_no++)
         if (c->devices[dev_no].is_ata)
           identify_ata_device (&c->devices[dev_no]);
     }
+  start_ticks = timer_ticks ();
+}
+
+/* Called by the timer interrupt handler at each timer tick to
+   sample how busy each channel is. */
+void
+ide_tick (void)
+{
+  struct channel *c;
+
+  for (c = channels; c < channels + CHANNEL_CNT; c++)
+    if (c->busy)
+      c->busy_ticks++;
+}
+
+/* Prints utilization statistics for each channel that has an
+   ATA disk. */
+void
+ide_print_stats (void)
+{
+  int64_t elapsed = timer_elapsed (start_ticks);
+  struct channel *c;
+
+  for (c = channels; c < channels + CHANNEL_CNT; c++)
+    if (c->devices[0].is_ata || c->devices[1].is_ata)
+      printf ("%s: %lld of %lld ticks busy (%lld%%), "
+              "%lld requests in %lld commands\n",
+              c->name, c->busy_ticks, elapsed,
+              elapsed > 0 ? c->busy_ticks * 100 / elapsed : 0,
+              c->request_cnt, c->command_cnt);
 }
 
 /* Disk detection and identification. */
@@ -284,6 +441,7 @@ identify_ata_device (struct ata_disk *d)
   /* Calculate capacity.
      Read model name and serial number. */
   capacity = *(uint32_t *) &id[60 * 2];
+  d->dma = c->bm_base != 0 && (*(uint16_t *) &id[49 * 2] & 0x100) != 0;
   model = descramble_ata_string (&id[10 * 2], 20);
   serial = descramble_ata_string (&id[27 * 2], 40);
   snprintf (extra_info, sizeof extra_info,
@@ -303,12 +461,38 @@ identify_ata_device (struct ata_disk *d)
       return;
     }
 
+  /* Enable READ/WRITE MULTIPLE with the largest block size the
+     disk supports, so that PIO transfers of several sectors take
+     one interrupt per block rather than one per sector. */
+  set_multiple_mode (d, *(uint16_t *) &id[47 * 2] & 0xff);
+
   /* Register. */
   block = block_register (d->name, BLOCK_RAW, extra_info, capacity,
                           &ide_operations, d);
   partition_scan (block);
 }
 
+/* Sends a SET MULTIPLE MODE command to disk D asking for
+   SECTORS sectors per block, and records the result in D's
+   multiple member. */
+static void
+set_multiple_mode (struct ata_disk *d, int sectors)
+{
+  struct channel *c = d->channel;
+
+  d->multiple = 0;
+  if (sectors <= 0)
+    return;
+
+  select_device_wait (d);
+  outb (reg_nsect (c), sectors);
+  issue_pio_command (c, CMD_SET_MULTIPLE_MODE);
+  sema_down (&c->completion_wait);
+  wait_while_busy (d);
+  if ((inb (reg_alt_status (c)) & STA_ERR) == 0)
+    d->multiple = sectors;
+}
+
 /* Translates STRING, which consists of SIZE bytes in a funky
    format, into a null-terminated string in-place.  Drops
    trailing whitespace and null bytes.  Returns STRING.  */
@@ -337,63 +521,199 @@ descramble_ata_string (char *string, int size)
   return string;
 }
 
-/* Reads sector SEC_NO from disk D into BUFFER, which must have
-   room for BLOCK_SECTOR_SIZE bytes.
-   Internally synchronizes accesses to disks, so external
-   per-disk locking is unneeded. */
+/* Request queue.
+
+   Each channel keeps the requests submitted for its disks in a
+   single queue sorted by "queue key", which places all of
+   device 0's sectors before all of device 1's.  Requests are
+   served in C-LOOK order: the head sweeps upward through the
+   keys, taking the next request at or past where the last
+   transfer ended, and jumps back to the lowest key once nothing
+   is left ahead of it.  A request is merged into one ATA command
+   with the queued requests that continue it on the same disk in
+   the same direction.
+
+   Submitters return at once.  Each channel has a worker thread
+   that takes requests off the queue and carries them out, so
+   both channels transfer data at the same time and one thread
+   may have requests outstanding on both. */
+
+/* Returns the queue key of request R. */
+static uint32_t
+queue_key (const struct block_request *r)
+{
+  const struct ata_disk *d = r->driver;
+  return ((uint32_t) d->dev_no << 28) | r->sector;
+}
+
+/* Orders requests by queue key. */
+static bool
+queue_key_less (const struct list_elem *a_, const struct list_elem *b_,
+                void *aux UNUSED)
+{
+  const struct block_request *a = list_entry (a_, struct block_request, elem);
+  const struct block_request *b = list_entry (b_, struct block_request, elem);
+  return queue_key (a) < queue_key (b);
+}
+
+/* Removes the next run of requests, in C-LOOK order, from C's
+   queue and stores them in RUN, which must have room for
+   MAX_SEGMENTS elements.  Returns the number of requests.  The
+   caller must hold C's queue lock and the queue must not be
+   empty. */
+static size_t
+take_run (struct channel *c, struct block_request *run[])
+{
+  struct list_elem *e;
+  struct block_request *r;
+  size_t n = 0, cnt = 0;
+  uint32_t end;
+
+  ASSERT (!list_empty (&c->queue));
+
+  for (e = list_begin (&c->queue); e != list_end (&c->queue);
+       e = list_next (e))
+    if (queue_key (list_entry (e, struct block_request, elem)) >= c->head)
+      break;
+  if (e == list_end (&c->queue))
+    e = list_begin (&c->queue);
+
+  r = list_entry (e, struct block_request, elem);
+  end = queue_key (r);
+  for (;;)
+    {
+      e = list_remove (&r->elem);
+      run[n++] = r;
+      cnt += r->cnt;
+      end += r->cnt;
+      if (e == list_end (&c->queue) || n >= MAX_SEGMENTS)
+        break;
+
+      r = list_entry (e, struct block_request, elem);
+      if (r->driver != run[0]->driver || r->write != run[0]->write
+          || queue_key (r) != end || cnt + r->cnt > MAX_SECTORS_PER_CMD)
+        break;
+    }
+  c->head = end;
+  return n;
+}
+
+/* Transfers CNT sectors starting at SEC_NO between disk D and the
+   buffers described by the SEG_CNT segments in SEGS, with a
+   single ATA command. */
 static void
-ide_read (void *d_, block_sector_t sec_no, void *buffer)
+transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+          const struct segment *segs, size_t seg_cnt, bool write)
 {
-  struct ata_disk *d = d_;
   struct channel *c = d->channel;
+
   lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-  sema_down (&c->completion_wait);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-  input_sector (c, buffer);
+  if (use_dma (d, segs, seg_cnt))
+    dma_transfer (d, sec_no, cnt, segs, seg_cnt, write);
+  else
+    pio_transfer (d, sec_no, cnt, segs, write);
+  c->command_cnt++;
   lock_release (&c->lock);
 }
 
-/* Write sector SEC_NO to disk D from BUFFER, which must contain
-   BLOCK_SECTOR_SIZE bytes.  Returns after the disk has
-   acknowledged receiving the data.
+/* Carries out the N requests in RUN, as returned by take_run(),
+   and notifies their submitters. */
+static void
+do_run (struct block_request *run[], size_t n)
+{
+  struct ata_disk *d = run[0]->driver;
+  struct segment segs[MAX_SEGMENTS];
+  size_t i, cnt = 0;
+
+  if (n == 1)
+    {
+      /* A lone request may be too big for one command. */
+      struct block_request *r = run[0];
+      size_t ofs;
+
+      for (ofs = 0; ofs < r->cnt; ofs += MAX_SECTORS_PER_CMD)
+        {
+          segs[0].buffer = (uint8_t *) r->buffer + ofs * BLOCK_SECTOR_SIZE;
+          segs[0].cnt = r->cnt - ofs < MAX_SECTORS_PER_CMD
+                        ? r->cnt - ofs : MAX_SECTORS_PER_CMD;
+          transfer (d, r->sector + ofs, segs[0].cnt, segs, 1, r->write);
+        }
+    }
+  else
+    {
+      for (i = 0; i < n; i++)
+        {
+          segs[i].buffer = run[i]->buffer;
+          segs[i].cnt = run[i]->cnt;
+          cnt += run[i]->cnt;
+        }
+      transfer (d, run[0]->sector, cnt, segs, n, run[0]->write);
+    }
+
+  d->channel->request_cnt += n;
+  for (i = 0; i < n; i++)
+    run[i]->done (run[i]);
+}
+
+/* Worker thread for channel C_: serves C_'s request queue
+   forever. */
+static void
+channel_worker (void *c_)
+{
+  struct channel *c = c_;
+
+  for (;;)
+    {
+      struct block_request *run[MAX_SEGMENTS];
+      size_t n;
+
+      lock_acquire (&c->queue_lock);
+      while (list_empty (&c->queue))
+        cond_wait (&c->queue_nonempty, &c->queue_lock);
+      n = take_run (c, run);
+      lock_release (&c->queue_lock);
+
+      c->busy = true;
+      do_run (run, n);
+      c->busy = false;
+    }
+}
+
+/* Queues request R for disk D and returns.  The channel's worker
+   thread calls R's completion function once it is done.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 static void
-ide_write (void *d_, block_sector_t sec_no, const void *buffer)
+ide_submit (void *d_, struct block_request *r)
 {
   struct ata_disk *d = d_;
   struct channel *c = d->channel;
-  lock_acquire (&c->lock);
-  select_sector (d, sec_no);
-  issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-  if (!wait_while_busy (d))
-    PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-  output_sector (c, buffer);
-  sema_down (&c->completion_wait);
-  lock_release (&c->lock);
+
+  lock_acquire (&c->queue_lock);
+  list_insert_ordered (&c->queue, &r->elem, queue_key_less, NULL);
+  cond_signal (&c->queue_nonempty, &c->queue_lock);
+  lock_release (&c->queue_lock);
 }
 
 static struct block_operations ide_operations =
   {
-    ide_read,
-    ide_write
+    .submit = ide_submit
   };
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and the sector count CNT, which must be between 1
+   and 256, to the disk's sector selection registers.  (We use
+   LBA mode.) */
 static void
-select_sector (struct ata_disk *d, block_sector_t sec_no)
+select_sector (struct ata_disk *d, block_sector_t sec_no, size_t cnt)
 {
   struct channel *c = d->channel;
 
   ASSERT (sec_no < (1UL << 28));
+  ASSERT (cnt >= 1 && cnt <= 256);
   
   select_device_wait (d);
-  outb (reg_nsect (c), 1);
+  outb (reg_nsect (c), cnt);
   outb (reg_lbal (c), sec_no);
   outb (reg_lbam (c), sec_no >> 8);
   outb (reg_lbah (c), (sec_no >> 16));
@@ -430,6 +750,193 @@ output_sector (struct channel *c, const void *sector)
   outsw (reg_data (c), sector, BLOCK_SECTOR_SIZE / 2);
 }
 
+/* Transfers CNT sectors starting at SEC_NO between disk D and the
+   buffers described by SEGS in PIO mode, from the disk into the
+   buffers unless WRITE is true.  Uses READ/WRITE MULTIPLE if the
+   disk has it enabled, otherwise READ/WRITE SECTORS, which take
+   an interrupt per sector.  The caller must hold D's channel
+   lock. */
+static void
+pio_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              const struct segment *segs, bool write)
+{
+  struct channel *c = d->channel;
+  size_t per_intr = d->multiple > 0 ? (size_t) d->multiple : 1;
+  size_t done = 0, seg_ofs = 0;
+
+  select_sector (d, sec_no, cnt);
+  if (write)
+    issue_pio_command (c, d->multiple > 0 ? CMD_WRITE_MULTIPLE
+                                          : CMD_WRITE_SECTOR_RETRY);
+  else
+    issue_pio_command (c, d->multiple > 0 ? CMD_READ_MULTIPLE
+                                          : CMD_READ_SECTOR_RETRY);
+  while (done < cnt)
+    {
+      size_t blk = cnt - done < per_intr ? cnt - done : per_intr;
+
+      /* A read block is announced by an interrupt; a write block
+         is requested by DRQ and acknowledged by an interrupt. */
+      if (!write)
+        sema_down (&c->completion_wait);
+      if (!wait_while_busy (d))
+        PANIC ("%s: disk %s failed, sector=%"PRDSNu, d->name,
+               write ? "write" : "read", sec_no + done);
+      for (; blk > 0; blk--, done++)
+        {
+          uint8_t *sector = segs->buffer + seg_ofs * BLOCK_SECTOR_SIZE;
+          if (write)
+            output_sector (c, sector);
+          else
+            input_sector (c, sector);
+          if (++seg_ofs == segs->cnt)
+            {
+              segs++;
+              seg_ofs = 0;
+            }
+        }
+      if (write)
+        sema_down (&c->completion_wait);
+    }
+}
+
+/* Bus master DMA. */
+
+/* Reads the 32-bit PCI configuration register REG of device DEV,
+   function FUNC on bus 0. */
+static uint32_t
+pci_read_config (int dev, int func, int reg)
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  return inl (PCI_CONFIG_DATA);
+}
+
+/* Writes VALUE to the 32-bit PCI configuration register REG of
+   device DEV, function FUNC on bus 0. */
+static void
+pci_write_config (int dev, int func, int reg, uint32_t value)
+{
+  outl (PCI_CONFIG_ADDR, 0x80000000 | (dev << 11) | (func << 8) | reg);
+  outl (PCI_CONFIG_DATA, value);
+}
+
+/* Looks for a PCI IDE controller on bus 0 (the PIIX emulated by
+   QEMU and Bochs lives there), enables bus mastering on it, and
+   returns the base I/O port of its bus master registers, or 0 if
+   there is no such controller. */
+static uint16_t
+find_bus_master (void)
+{
+  int dev, func;
+
+  for (dev = 0; dev < 32; dev++)
+    for (func = 0; func < 8; func++)
+      {
+        uint32_t bar4;
+
+        if ((pci_read_config (dev, func, PCI_REG_ID) & 0xffff) == 0xffff
+            || pci_read_config (dev, func, PCI_REG_CLASS) >> 16
+               != PCI_CLASS_IDE)
+          continue;
+
+        /* The bus master registers must be in I/O space. */
+        bar4 = pci_read_config (dev, func, PCI_REG_BAR4);
+        if ((bar4 & 1) == 0 || (bar4 & ~3u) == 0)
+          continue;
+
+        pci_write_config (dev, func, PCI_REG_COMMAND,
+                          pci_read_config (dev, func, PCI_REG_COMMAND)
+                          | PCI_CMD_IO | PCI_CMD_MASTER);
+        return bar4 & 0xfffc;
+      }
+  return 0;
+}
+
+/* Returns true if a transfer between disk D and the SEG_CNT
+   buffers in SEGS can be done with bus master DMA.  The
+   controller needs physical addresses, so each buffer must be a
+   word-aligned kernel virtual address; kernel virtual memory maps
+   physical memory linearly, so such a buffer is physically
+   contiguous. */
+static bool
+use_dma (const struct ata_disk *d, const struct segment *segs,
+         size_t seg_cnt)
+{
+  size_t i;
+
+  if (!d->dma)
+    return false;
+  for (i = 0; i < seg_cnt; i++)
+    if (!is_kernel_vaddr (segs[i].buffer) || ((uintptr_t) segs[i].buffer & 1))
+      return false;
+  return true;
+}
+
+/* Fills channel C's PRD table to describe the SEG_CNT buffers in
+   SEGS, splitting each wherever it crosses a 64 kB boundary. */
+static void
+build_prd_table (struct channel *c, const struct segment *segs,
+                 size_t seg_cnt)
+{
+  struct prd *prd = c->prd;
+  size_t i;
+
+  ASSERT (seg_cnt > 0);
+  for (i = 0; i < seg_cnt; i++)
+    {
+      uintptr_t paddr = vtop (segs[i].buffer);
+      size_t size = segs[i].cnt * BLOCK_SECTOR_SIZE;
+
+      while (size > 0)
+        {
+          size_t chunk = 0x10000 - (paddr & 0xffff);
+          if (chunk > size)
+            chunk = size;
+
+          ASSERT (prd < c->prd + PGSIZE / sizeof *prd);
+          prd->addr = paddr;
+          prd->size = chunk & 0xffff;
+          prd->flags = 0;
+          prd++;
+
+          paddr += chunk;
+          size -= chunk;
+        }
+    }
+  prd[-1].flags = PRD_EOT;
+}
+
+/* Transfers CNT sectors starting at SEC_NO between disk D and the
+   SEG_CNT buffers in SEGS with bus master DMA: from the disk into
+   the buffers if WRITE is false, to the disk otherwise.  The CPU
+   is free to run other threads until the completion interrupt
+   arrives.  The caller must hold D's channel lock and have
+   checked use_dma(). */
+static void
+dma_transfer (struct ata_disk *d, block_sector_t sec_no, size_t cnt,
+              const struct segment *segs, size_t seg_cnt, bool write)
+{
+  struct channel *c = d->channel;
+  uint8_t direction = write ? 0 : BM_CMD_READ;
+
+  build_prd_table (c, segs, seg_cnt);
+  outl (reg_bm_prdt (c), vtop (c->prd));
+  outb (reg_bm_command (c), direction);
+  outb (reg_bm_status (c),
+        inb (reg_bm_status (c)) | BM_STA_ERROR | BM_STA_INTR);
+
+  select_sector (d, sec_no, cnt);
+  issue_pio_command (c, write ? CMD_WRITE_DMA : CMD_READ_DMA);
+  outb (reg_bm_command (c), direction | BM_CMD_START);
+  sema_down (&c->completion_wait);
+  outb (reg_bm_command (c), direction);
+
+  if ((c->bm_status & BM_STA_ERROR) != 0
+      || (inb (reg_alt_status (c)) & STA_ERR) != 0)
+    PANIC ("%s: DMA %s failed, sector=%"PRDSNu, d->name,
+           write ? "write" : "read", sec_no);
+}
+
 /* Low-level ATA primitives. */
 
 /* Wait up to 10 seconds for the controller to become idle, that
@@ -514,6 +1021,14 @@ interrupt_handler (struct intr_frame *f)
         if (c->expecting_interrupt) 
           {
             inb (reg_status (c));               /* Acknowledge interrupt. */
+            if (c->bm_base != 0)
+              {
+                /* Save and clear the bus master interrupt bit,
+                   leaving the error bit for dma_transfer(). */
+                c->bm_status = inb (reg_bm_status (c));
+                outb (reg_bm_status (c),
+                      (c->bm_status & ~BM_STA_ERROR) | BM_STA_INTR);
+              }
             sema_up (&c->completion_wait);      /* Wake up waiter. */
           }
         else
@@ -0,0 +1,132 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A block device whose sectors live in kernel memory.
+
+   It is meant for the swap and scratch roles, e.g. with
+   "-ramdisk=4096 -swap=ram0", to take disk latency out of VM
+   experiments.  Its contents do not survive a reboot.  The
+   memory comes from the kernel pool one page at a time, so the
+   disk need not be physically contiguous. */
+
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* A RAM disk. */
+struct ramdisk
+  {
+    uint8_t **pages;            /* Pages holding the sectors, in order. */
+    size_t page_cnt;            /* Number of pages. */
+  };
+
+static struct block_operations ramdisk_operations;
+
+/* Creates and registers a RAM disk named "ram0" of KB kilobytes,
+   rounded up to a whole number of pages.  Panics if there is not
+   enough kernel memory. */
+void
+ramdisk_init (size_t kb)
+{
+  struct ramdisk *rd;
+  size_t i;
+
+  if (kb == 0)
+    return;
+
+  rd = malloc (sizeof *rd);
+  if (rd == NULL)
+    PANIC ("ram0: out of memory");
+  rd->page_cnt = DIV_ROUND_UP (kb * 1024, PGSIZE);
+  rd->pages = malloc (rd->page_cnt * sizeof *rd->pages);
+  if (rd->pages == NULL)
+    PANIC ("ram0: out of memory");
+  for (i = 0; i < rd->page_cnt; i++)
+    {
+      rd->pages[i] = palloc_get_page (PAL_ZERO);
+      if (rd->pages[i] == NULL)
+        PANIC ("ram0: out of memory after %zu of %zu pages",
+               i, rd->page_cnt);
+    }
+
+  block_register ("ram0", BLOCK_RAW, "RAM disk",
+                  rd->page_cnt * SECTORS_PER_PAGE, &ramdisk_operations, rd);
+}
+
+/* Returns the address of sector SECTOR within RD. */
+static uint8_t *
+sector_addr (struct ramdisk *rd, block_sector_t sector)
+{
+  return (rd->pages[sector / SECTORS_PER_PAGE]
+          + sector % SECTORS_PER_PAGE * BLOCK_SECTOR_SIZE);
+}
+
+/* Reads the CNT sectors starting at SECTOR from RAM disk RD_ into
+   BUFFER, a page at a time. */
+static void
+ramdisk_read_multi (void *rd_, block_sector_t sector, size_t cnt,
+                    void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      size_t chunk = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (chunk > cnt)
+        chunk = cnt;
+      memcpy (buffer, sector_addr (rd, sector), chunk * BLOCK_SECTOR_SIZE);
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      sector += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Writes the CNT sectors starting at SECTOR to RAM disk RD_ from
+   BUFFER, a page at a time. */
+static void
+ramdisk_write_multi (void *rd_, block_sector_t sector, size_t cnt,
+                     const void *buffer_)
+{
+  struct ramdisk *rd = rd_;
+  const uint8_t *buffer = buffer_;
+
+  while (cnt > 0)
+    {
+      size_t chunk = SECTORS_PER_PAGE - sector % SECTORS_PER_PAGE;
+      if (chunk > cnt)
+        chunk = cnt;
+      memcpy (sector_addr (rd, sector), buffer, chunk * BLOCK_SECTOR_SIZE);
+      buffer += chunk * BLOCK_SECTOR_SIZE;
+      sector += chunk;
+      cnt -= chunk;
+    }
+}
+
+/* Reads sector SECTOR from RAM disk RD into BUFFER. */
+static void
+ramdisk_read (void *rd, block_sector_t sector, void *buffer)
+{
+  ramdisk_read_multi (rd, sector, 1, buffer);
+}
+
+/* Writes sector SECTOR to RAM disk RD from BUFFER. */
+static void
+ramdisk_write (void *rd, block_sector_t sector, const void *buffer)
+{
+  ramdisk_write_multi (rd, sector, 1, buffer);
+}
+
+static struct block_operations ramdisk_operations =
+  {
+    ramdisk_read,
+    ramdisk_write,
+    ramdisk_read_multi,
+    ramdisk_write_multi,
+    NULL
+  };
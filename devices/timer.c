@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "devices/ide.h"
 #include "devices/pit.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
@@ -84,6 +85,17 @@ timer_elapsed (int64_t then)
   return timer_ticks () - then;
 }
 
+/* Returns the CPU's time-stamp counter, which counts clock
+   cycles since reset.  Much finer than timer_ticks(), for
+   measuring short intervals such as a disk transfer. */
+uint64_t
+timer_cycles (void)
+{
+  uint64_t tsc;
+  asm volatile ("rdtsc" : "=A" (tsc));
+  return tsc;
+}
+
 /* Sleeps for approximately TICKS timer ticks.  
    Interrupts must be turned on. 
    Disable the interrupt when timer_sleep() because it can cause problem in wait queue*/
@@ -188,6 +200,7 @@ timer_interrupt (struct intr_frame *args UNUSED)
     }
   }
   thread_tick(timer_ticks());
+  ide_tick();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -0,0 +1,37 @@
+#ifndef __LIB_BLOCKSTAT_H
+#define __LIB_BLOCKSTAT_H
+
+/* Block device roles accepted by the blockstat system call.
+   These match the kernel's enum block_type. */
+#define BLOCKSTAT_KERNEL 0      /* Pintos OS kernel. */
+#define BLOCKSTAT_FILESYS 1     /* File system. */
+#define BLOCKSTAT_SCRATCH 2     /* Scratch. */
+#define BLOCKSTAT_SWAP 3        /* Swap. */
+
+/* Number of latency histogram buckets.  Bucket I counts requests
+   that took from 2**I up to 2**(I+1) CPU cycles, except that the
+   first and last buckets also take everything below or above. */
+#define BLOCKSTAT_BUCKETS 32
+
+/* I/O counters for one block device, shared between the kernel
+   and user programs so that the blockstat system call can copy
+   them out as-is.  Requests made through a partition are counted
+   only against the partition, not against its disk. */
+struct block_stat
+  {
+    long long read_cnt;                 /* Sectors read. */
+    long long write_cnt;                /* Sectors written. */
+    long long read_bytes;               /* Bytes read. */
+    long long write_bytes;              /* Bytes written. */
+
+    long long request_cnt;              /* Requests completed. */
+    long long seq_request_cnt;          /* Requests that started where the
+                                           previous one ended. */
+    long long queue_depth;              /* Requests in flight now. */
+    long long max_queue_depth;          /* Most requests ever in flight. */
+
+    long long latency_cycles;           /* Sum of request latencies. */
+    long long latency[BLOCKSTAT_BUCKETS];       /* Latency histogram. */
+  };
+
+#endif /* lib/blockstat.h */
@@ -0,0 +1,18 @@
+#ifndef __LIB_IOVEC_H
+#define __LIB_IOVEC_H
+
+#include <stddef.h>
+
+/* Most buffers one readv or writev system call accepts. */
+#define IOV_MAX 16
+
+/* One buffer of a vectored read or write, shared between the
+   kernel and user programs so that the readv and writev system
+   calls can copy the array in as-is. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Number of bytes. */
+  };
+
+#endif /* lib/iovec.h */
@@ -0,0 +1,20 @@
+#ifndef __LIB_SPAWN_H
+#define __LIB_SPAWN_H
+
+/* Most descriptors one spawn system call passes to the child. */
+#define SPAWN_FD_MAX 16
+
+/* Descriptor numbers given to the child must be below this.
+   0, 1 and 2 are the console and cannot be given. */
+#define SPAWN_FD_LIMIT 128
+
+/* Makes the parent's descriptor PARENT_FD available to the child
+   as CHILD_FD.  The child's descriptor refers to the same file
+   but has its own position. */
+struct spawn_fd
+  {
+    int parent_fd;              /* Descriptor in the parent. */
+    int child_fd;               /* Descriptor number in the child. */
+  };
+
+#endif /* lib/spawn.h */
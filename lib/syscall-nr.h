@@ -30,7 +30,24 @@ enum
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
     SYS_INUMBER,                 /* Returns the inode number for a fd. */
     SYS_FIBO,
-    SYS_MAXFOUR
+    SYS_MAXFOUR,
+
+    /* Statistics. */
+    SYS_VMSTAT,                 /* Reads virtual memory counters. */
+    SYS_BLOCKSTAT,              /* Reads block device counters. */
+
+    /* File copying. */
+    SYS_COPY_FILE_RANGE,        /* Copies data between two files. */
+
+    /* Vectored and positional I/O. */
+    SYS_READV,                  /* Reads into several buffers. */
+    SYS_WRITEV,                 /* Writes from several buffers. */
+    SYS_PREAD,                  /* Reads at a given offset. */
+    SYS_PWRITE,                 /* Writes at a given offset. */
+
+    /* Process creation. */
+    SYS_SPAWN                   /* Start a process without waiting
+                                   for it to load. */
   };
 
 #endif /* lib/syscall-nr.h */
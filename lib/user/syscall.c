@@ -101,6 +101,12 @@ wait (pid_t pid)
   return syscall1 (SYS_WAIT, pid);
 }
 
+pid_t
+spawn (const char *argv[], const struct spawn_fd *fds, int fd_cnt)
+{
+  return (pid_t) syscall3 (SYS_SPAWN, argv, fds, fd_cnt);
+}
+
 bool
 create (const char *file, unsigned initial_size)
 {
@@ -206,4 +212,46 @@ int
 max_of_four_int(int a, int b, int c, int d)
 {
   return syscall4(SYS_MAXFOUR,a,b,c,d);
-}
\ No newline at end of file
+}
+
+void
+vmstat (struct vm_stat *proc, struct vm_stat *global)
+{
+  syscall2 (SYS_VMSTAT, proc, global);
+}
+
+int
+copy_file_range (int in_fd, int out_fd, unsigned length)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, in_fd, out_fd, length);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, length, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned length, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, length, offset);
+}
+
+bool
+blockstat (int role, struct block_stat *stat)
+{
+  return syscall2 (SYS_BLOCKSTAT, role, stat);
+}
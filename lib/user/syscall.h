@@ -3,6 +3,10 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <vmstat.h>
+#include <blockstat.h>
+#include <iovec.h>
+#include <spawn.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -24,6 +28,7 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t exec (const char *file);
 int wait (pid_t);
+pid_t spawn (const char *argv[], const struct spawn_fd *, int fd_cnt);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
 int open (const char *file);
@@ -33,6 +38,11 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
@@ -47,4 +57,8 @@ int inumber (int fd);
 
 int fibonacci(int n);
 int max_of_four_int(int a, int b, int c, int d);
+
+/* Statistics.  Either pointer may be null. */
+void vmstat (struct vm_stat *proc, struct vm_stat *global);
+bool blockstat (int role, struct block_stat *);
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,27 @@
+#ifndef __LIB_VMSTAT_H
+#define __LIB_VMSTAT_H
+
+/* Virtual memory counters, shared between the kernel and user
+   programs so that the vmstat system call can copy them out
+   as-is.  The kernel keeps one copy per process and one global
+   copy; fields marked "global only" stay zero in the per-process
+   copy. */
+struct vm_stat
+  {
+    /* Page faults resolved, by the state the page was in. */
+    long long swap_fault_cnt;           /* ON_SWAP: read back from swap. */
+    long long zero_fault_cnt;           /* ALL_ZERO: fresh zeroed page. */
+    long long filesys_fault_cnt;        /* FROM_FILESYS: read from a file. */
+
+    /* Frame eviction (clock algorithm). */
+    long long evict_cnt;                /* Frames evicted. */
+    long long sweep_cnt;                /* Frames examined by the clock hand. */
+    long long sweep_max;                /* Longest single sweep. */
+    long long pin_skip_cnt;             /* Pinned frames the hand passed over. */
+
+    /* Swap device, global only. */
+    long long swap_slots_used;          /* Swap slots currently in use. */
+    long long swap_slots_peak;          /* Most swap slots ever in use. */
+  };
+
+#endif /* lib/vmstat.h */
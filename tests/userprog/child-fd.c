@@ -0,0 +1,21 @@
+/* Child process run by spawn-fd test.
+
+   Reads all of the file that its parent passed down as
+   descriptor 20.  The parent had already read part of the file,
+   but the child's descriptor has its own position, which must
+   start at the beginning of the file. */
+
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+
+int
+main (void) 
+{
+  test_name = "child-fd";
+
+  msg ("begin");
+  check_file_handle (20, "sample.txt", sample, sizeof sample - 1);
+  msg ("end");
+
+  return 0;
+}
@@ -0,0 +1,26 @@
+/* Reads from the middle of "sample.txt" with pread, which must
+   not move the file position, and then at an offset too big for
+   a file, which must fail. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[20];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, 5) == 5, "read 5 bytes from \"sample.txt\"");
+
+  CHECK (pread (handle, buf, sizeof buf, 30) == (int) sizeof buf,
+         "pread 20 bytes at offset 30");
+  compare_bytes (buf, sample + 30, sizeof buf, 30, "sample.txt");
+  CHECK (tell (handle) == 5, "tell \"sample.txt\"");
+
+  msg ("pread() at offset 0x80000000: %d",
+       pread (handle, buf, 1, 0x80000000));
+}
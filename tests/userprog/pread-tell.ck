@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-tell) begin
+(pread-tell) open "sample.txt"
+(pread-tell) read 5 bytes from "sample.txt"
+(pread-tell) pread 20 bytes at offset 30
+(pread-tell) tell "sample.txt"
+(pread-tell) pread() at offset 0x80000000: -1
+(pread-tell) end
+pread-tell: exit(0)
+EOF
+pass;
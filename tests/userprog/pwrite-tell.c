@@ -0,0 +1,28 @@
+/* Writes the start of a file with write and the rest with
+   pwrite, which must not move the file position, and then tries
+   a pwrite whose end is too big for a file, which must fail. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int handle;
+
+  CHECK (create ("test.txt", sizeof sample - 1), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+  CHECK (write (handle, sample, 20) == 20, "write 20 bytes to \"test.txt\"");
+
+  CHECK (pwrite (handle, sample + 20, sizeof sample - 1 - 20, 20)
+         == (int) sizeof sample - 1 - 20, "pwrite the rest at offset 20");
+  CHECK (tell (handle) == 20, "tell \"test.txt\"");
+
+  msg ("pwrite() of 2 bytes at offset 0x7fffffff: %d",
+       pwrite (handle, sample, 2, 0x7fffffff));
+  close (handle);
+
+  check_file ("test.txt", sample, sizeof sample - 1);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pwrite-tell) begin
+(pwrite-tell) create "test.txt"
+(pwrite-tell) open "test.txt"
+(pwrite-tell) write 20 bytes to "test.txt"
+(pwrite-tell) pwrite the rest at offset 20
+(pwrite-tell) tell "test.txt"
+(pwrite-tell) pwrite() of 2 bytes at offset 0x7fffffff: -1
+(pwrite-tell) open "test.txt" for verification
+(pwrite-tell) verified contents of "test.txt"
+(pwrite-tell) close "test.txt"
+(pwrite-tell) end
+pwrite-tell: exit(0)
+EOF
+pass;
@@ -0,0 +1,33 @@
+/* Passes readv and writev IOV_MAX + 1 buffers, which they must
+   reject by returning -1 without touching the file, and then
+   IOV_MAX buffers, which readv must accept. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[IOV_MAX + 1];
+  struct iovec iov[IOV_MAX + 1];
+  int handle;
+  int i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  for (i = 0; i < IOV_MAX + 1; i++)
+    {
+      iov[i].iov_base = buf + i;
+      iov[i].iov_len = 1;
+    }
+  msg ("readv() with IOV_MAX + 1 buffers: %d",
+       readv (handle, iov, IOV_MAX + 1));
+  msg ("writev() with IOV_MAX + 1 buffers: %d",
+       writev (handle, iov, IOV_MAX + 1));
+
+  CHECK (readv (handle, iov, IOV_MAX) == IOV_MAX,
+         "readv() with IOV_MAX buffers");
+  compare_bytes (buf, sample, IOV_MAX, 0, "sample.txt");
+}
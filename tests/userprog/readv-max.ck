@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-max) begin
+(readv-max) open "sample.txt"
+(readv-max) readv() with IOV_MAX + 1 buffers: -1
+(readv-max) writev() with IOV_MAX + 1 buffers: -1
+(readv-max) readv() with IOV_MAX buffers
+(readv-max) end
+readv-max: exit(0)
+EOF
+pass;
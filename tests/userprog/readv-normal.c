@@ -0,0 +1,40 @@
+/* Reads "sample.txt" with readv into four buffers: the second
+   is empty and the third is bigger than the rest of the file.
+   The short read into the third buffer must end the call,
+   leaving the fourth buffer untouched. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[sizeof sample + 32];
+  char extra[16];
+  struct iovec iov[4];
+  int handle, byte_cnt;
+  size_t i;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  for (i = 0; i < sizeof extra; i++)
+    extra[i] = 'x';
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = NULL;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = buf + 10;
+  iov[2].iov_len = sizeof buf - 10;
+  iov[3].iov_base = extra;
+  iov[3].iov_len = sizeof extra;
+
+  byte_cnt = readv (handle, iov, 4);
+  if (byte_cnt != sizeof sample - 1)
+    fail ("readv() returned %d instead of %zu", byte_cnt, sizeof sample - 1);
+  compare_bytes (buf, sample, sizeof sample - 1, 0, "sample.txt");
+  for (i = 0; i < sizeof extra; i++)
+    if (extra[i] != 'x')
+      fail ("readv() wrote past its short read");
+}
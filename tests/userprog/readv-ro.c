@@ -0,0 +1,20 @@
+/* Passes readv a buffer in the read-only code segment.
+   The process must be terminated with -1 exit code. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct iovec iov;
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+
+  iov.iov_base = (void *) test_main;
+  iov.iov_len = 123;
+  readv (handle, &iov, 1);
+  fail ("should not have survived readv()");
+}
@@ -0,0 +1,10 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-ro) begin
+(readv-ro) open "sample.txt"
+readv-ro: exit(-1)
+EOF
+pass;
@@ -0,0 +1,15 @@
+/* Spawns a child with arguments that contain spaces or are
+   empty.  Unlike exec, spawn must pass each argument through as
+   given instead of splitting a command line at spaces. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *argv[] = {"child-args", "two words", "", " padded ", NULL};
+
+  msg ("wait(spawn()) = %d", wait (spawn (argv, NULL, 0)));
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-args) begin
+(args) begin
+(args) argc = 4
+(args) argv[0] = 'child-args'
+(args) argv[1] = 'two words'
+(args) argv[2] = ''
+(args) argv[3] = ' padded '
+(args) argv[4] = null
+(args) end
+child-args: exit(0)
+(spawn-args) wait(spawn()) = 0
+(spawn-args) end
+spawn-args: exit(0)
+EOF
+pass;
@@ -0,0 +1,19 @@
+/* Tries to give a spawned child a file as descriptor 0, 1, or 2,
+   which are reserved for the console.  spawn must return -1
+   each time without starting the child. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *argv[] = {"child-simple", NULL};
+  struct spawn_fd map;
+
+  CHECK ((map.parent_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  for (map.child_fd = 0; map.child_fd < 3; map.child_fd++)
+    msg ("spawn() with child_fd %d: %d",
+         map.child_fd, spawn (argv, &map, 1));
+}
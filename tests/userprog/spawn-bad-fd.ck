@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-bad-fd) begin
+(spawn-bad-fd) open "sample.txt"
+(spawn-bad-fd) spawn() with child_fd 0: -1
+(spawn-bad-fd) spawn() with child_fd 1: -1
+(spawn-bad-fd) spawn() with child_fd 2: -1
+(spawn-bad-fd) end
+spawn-bad-fd: exit(0)
+EOF
+pass;
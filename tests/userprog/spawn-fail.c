@@ -0,0 +1,18 @@
+/* Spawns a file that exists but is not an executable.  spawn
+   returns before the child tries to load it, so the failure
+   must show up as the child's exit status of -1. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *argv[] = {"sample.txt", NULL};
+  pid_t pid = spawn (argv, NULL, 0);
+
+  if (pid == PID_ERROR)
+    fail ("spawn(\"sample.txt\") returned %d", pid);
+  msg ("wait(spawn(\"sample.txt\")) = %d", wait (pid));
+}
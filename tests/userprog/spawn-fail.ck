@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF', <<'EOF']);
+(spawn-fail) begin
+load: sample.txt: error loading executable
+sample.txt: exit(-1)
+(spawn-fail) wait(spawn("sample.txt")) = -1
+(spawn-fail) end
+spawn-fail: exit(0)
+EOF
+(spawn-fail) begin
+sample.txt: exit(-1)
+(spawn-fail) wait(spawn("sample.txt")) = -1
+(spawn-fail) end
+spawn-fail: exit(0)
+EOF
+pass;
@@ -0,0 +1,30 @@
+/* Opens a file, reads part of it, and spawns a child that gets
+   the file as descriptor 20.  The child's descriptor has its own
+   position, so the child must read the file from the start, and
+   its reads must not move the parent's position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  const char *argv[] = {"child-fd", NULL};
+  struct spawn_fd map;
+  char buf[sizeof sample - 1];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (read (handle, buf, 10) == 10, "read 10 bytes from \"sample.txt\"");
+
+  map.parent_fd = handle;
+  map.child_fd = 20;
+  msg ("wait(spawn()) = %d", wait (spawn (argv, &map, 1)));
+
+  CHECK (tell (handle) == 10, "tell \"sample.txt\"");
+  CHECK (read (handle, buf + 10, sizeof buf - 10) == (int) sizeof buf - 10,
+         "read rest of \"sample.txt\"");
+  compare_bytes (buf, sample, sizeof buf, 0, "sample.txt");
+}
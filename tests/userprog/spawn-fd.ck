@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-fd) begin
+(spawn-fd) open "sample.txt"
+(spawn-fd) read 10 bytes from "sample.txt"
+(child-fd) begin
+(child-fd) verified contents of "sample.txt"
+(child-fd) end
+child-fd: exit(0)
+(spawn-fd) wait(spawn()) = 0
+(spawn-fd) tell "sample.txt"
+(spawn-fd) read rest of "sample.txt"
+(spawn-fd) end
+spawn-fd: exit(0)
+EOF
+pass;
@@ -1,10 +1,12 @@
 #include "threads/malloc.h"
 #include <debug.h>
+#include <limits.h>
 #include <list.h>
 #include <round.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -32,7 +34,28 @@
    because they're too big to fit in a single page with a
    descriptor.  We handle those by allocating contiguous pages
    with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   the beginning of the allocated block's arena header.
+
+   In front of each descriptor's free list, which we call the
+   "depot", sits a "magazine": a small stack of free blocks that
+   malloc() pops from and free() pushes onto with interrupts
+   briefly disabled, which is enough on our single CPU and much
+   cheaper than acquiring the descriptor's lock.  Only when the
+   magazine is empty does malloc() go to the depot, taking a
+   batch of blocks at once; likewise free() hands a batch back to
+   the depot only when the magazine is full.  Blocks sitting in
+   a magazine count as in use as far as their arena is concerned,
+   so an arena is never freed out from under a magazine. */
+
+/* Number of blocks a magazine holds. */
+#define MAG_SIZE 16
+
+/* Number of blocks moved between a magazine and its depot at
+   once. */
+#define MAG_BATCH (MAG_SIZE / 2)
+
+/* Smallest block size, as a power of 2. */
+#define MIN_SIZE_SHIFT 4
 
 /* Descriptor. */
 struct desc
@@ -41,6 +64,10 @@ struct desc
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+
+    /* Magazine.  Accessed only with interrupts disabled. */
+    struct block *mag[MAG_SIZE];        /* Free blocks. */
+    size_t mag_cnt;                     /* Number of blocks in MAG. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -66,6 +93,9 @@ static size_t desc_cnt;         /* Number of descriptors. */
 
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static struct desc *size_to_desc (size_t);
+static size_t depot_get (struct desc *, struct block **, size_t cnt);
+static void depot_put (struct desc *, struct block **, size_t cnt);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -73,7 +103,8 @@ malloc_init (void)
 {
   size_t block_size;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  for (block_size = 1 << MIN_SIZE_SHIFT; block_size < PGSIZE / 2;
+       block_size *= 2)
     {
       struct desc *d = &descs[desc_cnt++];
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
@@ -81,9 +112,29 @@ malloc_init (void)
       d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
       list_init (&d->free_list);
       lock_init (&d->lock);
+      d->mag_cnt = 0;
     }
 }
 
+/* Returns the smallest descriptor whose blocks can hold SIZE
+   bytes, or a null pointer if SIZE is too big for any of them.
+   SIZE must be nonzero.  Block sizes are consecutive powers of
+   2, so the answer follows directly from the position of the
+   most significant bit in SIZE - 1. */
+static struct desc *
+size_to_desc (size_t size)
+{
+  size_t idx;
+
+  ASSERT (size > 0);
+  if (size <= 1 << MIN_SIZE_SHIFT)
+    idx = 0;
+  else
+    idx = (sizeof (unsigned) * CHAR_BIT - __builtin_clz (size - 1)
+           - MIN_SIZE_SHIFT);
+  return idx < desc_cnt ? &descs[idx] : NULL;
+}
+
 /* Obtains and returns a new block of at least SIZE bytes.
    Returns a null pointer if memory is not available. */
 void *
@@ -92,6 +143,9 @@ malloc (size_t size)
   struct desc *d;
   struct block *b;
   struct arena *a;
+  struct block *batch[MAG_BATCH];
+  size_t cnt;
+  enum intr_level old_level;
 
   /* A null pointer satisfies a request for 0 bytes. */
   if (size == 0)
@@ -99,10 +153,8 @@ malloc (size_t size)
 
   /* Find the smallest descriptor that satisfies a SIZE-byte
      request. */
-  for (d = descs; d < descs + desc_cnt; d++)
-    if (d->block_size >= size)
-      break;
-  if (d == descs + desc_cnt) 
+  d = size_to_desc (size);
+  if (d == NULL)
     {
       /* SIZE is too big for any descriptor.
          Allocate enough pages to hold SIZE plus an arena. */
@@ -119,19 +171,53 @@ malloc (size_t size)
       return a + 1;
     }
 
+  /* Common case: take a block from the magazine. */
+  old_level = intr_disable ();
+  if (d->mag_cnt > 0)
+    {
+      b = d->mag[--d->mag_cnt];
+      intr_set_level (old_level);
+      return b;
+    }
+  intr_set_level (old_level);
+
+  /* The magazine is empty.  Get a batch of blocks from the depot,
+     return one of them and load the rest into the magazine.  If
+     another thread refilled the magazine in the meantime, give
+     back whatever does not fit. */
+  cnt = depot_get (d, batch, MAG_BATCH);
+  if (cnt == 0)
+    return NULL;
+  old_level = intr_disable ();
+  while (cnt > 1 && d->mag_cnt < MAG_SIZE)
+    d->mag[d->mag_cnt++] = batch[--cnt];
+  intr_set_level (old_level);
+  if (cnt > 1)
+    depot_put (d, batch + 1, cnt - 1);
+  return batch[0];
+}
+
+/* Takes up to CNT free blocks from D's depot and stores them in
+   BLOCKS, creating a new arena if the depot is empty.  Returns
+   the number of blocks obtained, which is 0 only if memory is
+   not available. */
+static size_t
+depot_get (struct desc *d, struct block **blocks, size_t cnt)
+{
+  struct arena *a;
+  size_t i;
+
   lock_acquire (&d->lock);
 
   /* If the free list is empty, create a new arena. */
   if (list_empty (&d->free_list))
     {
-      size_t i;
-
       /* Allocate a page. */
       a = palloc_get_page (0);
       if (a == NULL) 
         {
           lock_release (&d->lock);
-          return NULL; 
+          return 0; 
         }
 
       /* Initialize arena and add its blocks to the free list. */
@@ -145,12 +231,16 @@ malloc (size_t size)
         }
     }
 
-  /* Get a block from free list and return it. */
-  b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
-  a = block_to_arena (b);
-  a->free_cnt--;
+  /* Get blocks from free list. */
+  for (i = 0; i < cnt && !list_empty (&d->free_list); i++)
+    {
+      blocks[i] = list_entry (list_pop_front (&d->free_list),
+                              struct block, free_elem);
+      a = block_to_arena (blocks[i]);
+      a->free_cnt--;
+    }
   lock_release (&d->lock);
-  return b;
+  return i;
 }
 
 /* Allocates and return A times B bytes initialized to zeroes.
@@ -227,32 +317,31 @@ free (void *p)
       if (d != NULL) 
         {
           /* It's a normal block.  We handle it here. */
+          struct block *batch[MAG_BATCH + 1];
+          size_t cnt;
+          enum intr_level old_level;
 
 #ifndef NDEBUG
           /* Clear the block to help detect use-after-free bugs. */
           memset (b, 0xcc, d->block_size);
 #endif
-  
-          lock_acquire (&d->lock);
-
-          /* Add block to free list. */
-          list_push_front (&d->free_list, &b->free_elem);
 
-          /* If the arena is now entirely unused, free it. */
-          if (++a->free_cnt >= d->blocks_per_arena) 
+          /* Common case: put the block in the magazine.  If it is
+             full, move a batch of its blocks, along with this
+             one, back to the depot. */
+          old_level = intr_disable ();
+          if (d->mag_cnt < MAG_SIZE)
             {
-              size_t i;
-
-              ASSERT (a->free_cnt == d->blocks_per_arena);
-              for (i = 0; i < d->blocks_per_arena; i++) 
-                {
-                  struct block *b = arena_to_block (a, i);
-                  list_remove (&b->free_elem);
-                }
-              palloc_free_page (a);
+              d->mag[d->mag_cnt++] = b;
+              intr_set_level (old_level);
+              return;
             }
+          batch[0] = b;
+          for (cnt = 1; cnt <= MAG_BATCH; cnt++)
+            batch[cnt] = d->mag[--d->mag_cnt];
+          intr_set_level (old_level);
 
-          lock_release (&d->lock);
+          depot_put (d, batch, cnt);
         }
       else
         {
@@ -263,6 +352,40 @@ free (void *p)
     }
 }
 
+/* Returns the CNT blocks in BLOCKS to D's depot, giving any
+   arena that becomes entirely unused back to the page
+   allocator. */
+static void
+depot_put (struct desc *d, struct block **blocks, size_t cnt)
+{
+  size_t i;
+
+  lock_acquire (&d->lock);
+  for (i = 0; i < cnt; i++)
+    {
+      struct block *b = blocks[i];
+      struct arena *a = block_to_arena (b);
+
+      /* Add block to free list. */
+      list_push_front (&d->free_list, &b->free_elem);
+
+      /* If the arena is now entirely unused, free it. */
+      if (++a->free_cnt >= d->blocks_per_arena) 
+        {
+          size_t j;
+
+          ASSERT (a->free_cnt == d->blocks_per_arena);
+          for (j = 0; j < d->blocks_per_arena; j++) 
+            {
+              struct block *b = arena_to_block (a, j);
+              list_remove (&b->free_elem);
+            }
+          palloc_free_page (a);
+        }
+    }
+  lock_release (&d->lock);
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
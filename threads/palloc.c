@@ -2,13 +2,14 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,13 +24,52 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a buddy system.  Free pages are kept
+   in blocks of 2**ORDER pages that start at a page index (within
+   the pool) that is a multiple of 2**ORDER, with one free list
+   per order.  A request for N pages takes a block of the
+   smallest order that holds N pages, splitting larger blocks in
+   half as needed, and gives back any pages past the first N.
+   Freed pages are merged with their "buddy", the other half of
+   the block they were split from, for as long as the buddy is
+   free too, so free memory stays in large contiguous blocks.
+   Each free block is linked into its free list through a
+   list_elem at the start of its first page.
+
+   The pools are protected by disabling interrupts rather than
+   by a lock, because a dying thread's page is freed from the
+   scheduler, which cannot sleep.
+
+   Each pool also keeps a small stock of single pages that are
+   already zeroed, taken out of the buddy system and filled by
+   the idle thread through palloc_prezero().  A one-page PAL_ZERO
+   request is served from the stock when it can be, so the
+   memset() is done while the CPU would otherwise sit idle rather
+   than on the path of whoever wants the page, such as a page
+   fault on a new stack page.  The stock is given back when the
+   buddy system runs dry, so it never causes an allocation to
+   fail. */
+
+/* Number of block orders, so that the largest block has
+   2**(ORDER_CNT - 1) pages. */
+#define ORDER_CNT 20
+
+/* Maximum number of pre-zeroed pages kept per pool. */
+#define ZEROED_MAX 64
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *free_order;                /* Per page: 1 + order if first
+                                           page of a free block,
+                                           otherwise 0. */
+    struct list free_lists[ORDER_CNT];  /* Free blocks, by order. */
+    struct list zeroed;                 /* Pre-zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of pages in ZEROED. */
+    size_t page_cnt;                    /* Number of pages in pool. */
     uint8_t *base;                      /* Base of pool. */
   };
 
@@ -39,6 +79,11 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t take_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static void *take_zeroed (struct pool *);
+static void release_zeroed (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -73,13 +118,30 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
   size_t page_idx;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  if (page_cnt == 1 && (flags & PAL_ZERO)
+      && (pages = take_zeroed (pool)) != NULL)
+    {
+      /* Already zeroed. */
+      intr_set_level (old_level);
+      return pages;
+    }
+
+  page_idx = take_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && pool->zeroed_cnt > 0)
+    {
+      /* Fall back on the pre-zeroed pages. */
+      release_zeroed (pool);
+      page_idx = take_pages (pool, page_cnt);
+    }
+  if (page_idx != BITMAP_ERROR)
+    bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -113,12 +175,57 @@ palloc_get_page (enum palloc_flags flags)
   return palloc_get_multiple (flags, 1);
 }
 
+/* Zeroes one free page into the pre-zeroed stock of the user
+   pool, or of the kernel pool if the user pool's is full.
+   Returns true if a page was zeroed, false if both stocks are
+   full or there are no free pages to zero.  Meant to be called
+   from the idle thread with interrupts on; the memset() itself
+   runs with interrupts on, so it can be preempted. */
+bool
+palloc_prezero (void)
+{
+  struct pool *pools[] = { &user_pool, &kernel_pool };
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *pool = pools[i];
+      size_t page_idx = BITMAP_ERROR;
+      enum intr_level old_level;
+      void *page;
+
+      old_level = intr_disable ();
+      if (pool->zeroed_cnt < ZEROED_MAX)
+        {
+          page_idx = take_pages (pool, 1);
+          if (page_idx != BITMAP_ERROR)
+            {
+              bitmap_mark (pool->used_map, page_idx);
+              pool->zeroed_cnt++;
+            }
+        }
+      intr_set_level (old_level);
+      if (page_idx == BITMAP_ERROR)
+        continue;
+
+      page = pool->base + PGSIZE * page_idx;
+      memset (page, 0, PGSIZE);
+
+      old_level = intr_disable ();
+      list_push_front (&pool->zeroed, page);
+      intr_set_level (old_level);
+      return true;
+    }
+  return false;
+}
+
 /* Frees the PAGE_CNT pages starting at PAGES. */
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -137,8 +244,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  free_pages (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -153,10 +263,13 @@ palloc_free_page (void *page)
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and free_order array at its
+     base.  Calculate the space needed for them and subtract it
+     from the pool's size. */
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t bm_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -164,9 +277,150 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->free_order = (uint8_t *) base + bm_size;
+  memset (p->free_order, 0, page_cnt);
+  for (order = 0; order < ORDER_CNT; order++)
+    list_init (&p->free_lists[order]);
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->page_cnt = page_cnt;
   p->base = base + bm_pages * PGSIZE;
+  free_pages (p, 0, page_cnt);
+}
+
+/* Returns the first page of the block at PAGE_IDX in POOL. */
+static struct list_elem *
+block_elem (struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + PGSIZE * page_idx);
+}
+
+/* Returns the index within POOL of the block whose list element
+   is E. */
+static size_t
+elem_block (struct pool *pool, struct list_elem *e)
+{
+  return ((uint8_t *) e - pool->base) / PGSIZE;
+}
+
+/* Removes PAGE_CNT contiguous pages from POOL's free lists and
+   returns the index of the first one, or BITMAP_ERROR if there
+   is no free block large enough. */
+static size_t
+take_pages (struct pool *pool, size_t page_cnt)
+{
+  int want, order;
+  size_t page_idx;
+
+  /* Smallest order that holds PAGE_CNT pages. */
+  for (want = 0; want < ORDER_CNT && ((size_t) 1 << want) < page_cnt; want++)
+    continue;
+
+  /* Smallest free block of at least that order. */
+  for (order = want; order < ORDER_CNT; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order >= ORDER_CNT)
+    return BITMAP_ERROR;
+
+  page_idx = elem_block (pool, list_pop_front (&pool->free_lists[order]));
+  pool->free_order[page_idx] = 0;
+
+  /* Split it down to the order we want, freeing the upper
+     halves. */
+  while (order > want)
+    {
+      size_t buddy;
+
+      order--;
+      buddy = page_idx + ((size_t) 1 << order);
+      pool->free_order[buddy] = order + 1;
+      list_push_front (&pool->free_lists[order], block_elem (pool, buddy));
+    }
+
+  /* Give back the pages past PAGE_CNT. */
+  free_pages (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+  return page_idx;
+}
+
+/* Removes a page from POOL's pre-zeroed stock and returns it, or
+   returns a null pointer if the stock is empty.  The page stays
+   marked as in use. */
+static void *
+take_zeroed (struct pool *pool)
+{
+  struct list_elem *e;
+
+  if (list_empty (&pool->zeroed))
+    return NULL;
+  e = list_pop_front (&pool->zeroed);
+  pool->zeroed_cnt--;
+
+  /* The list element was the only nonzero data in the page. */
+  memset (e, 0, sizeof *e);
+  return e;
+}
+
+/* Returns every page in POOL's pre-zeroed stock to the buddy
+   system.  A page that palloc_prezero() is still zeroing is not
+   in the stock yet and stays with it. */
+static void
+release_zeroed (struct pool *pool)
+{
+  while (!list_empty (&pool->zeroed))
+    {
+      struct list_elem *e = list_pop_front (&pool->zeroed);
+      size_t page_idx = elem_block (pool, e);
+
+      pool->zeroed_cnt--;
+      bitmap_reset (pool->used_map, page_idx);
+      free_block (pool, page_idx, 0);
+    }
+}
+
+/* Adds the PAGE_CNT pages starting at PAGE_IDX in POOL to its
+   free lists, as the fewest blocks that are aligned to their own
+   size. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t end = page_idx + page_cnt;
+
+  while (page_idx < end)
+    {
+      int order = 0;
+
+      while (order + 1 < ORDER_CNT
+             && page_idx % ((size_t) 1 << (order + 1)) == 0
+             && page_idx + ((size_t) 1 << (order + 1)) <= end)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+    }
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX in POOL to
+   its free lists, first merging it with its buddy for as long as
+   the buddy is also free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  while (order + 1 < ORDER_CNT)
+    {
+      size_t buddy = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy >= pool->page_cnt || pool->free_order[buddy] != order + 1)
+        break;
+      list_remove (block_elem (pool, buddy));
+      pool->free_order[buddy] = 0;
+      if (buddy < page_idx)
+        page_idx = buddy;
+      order++;
+    }
+
+  pool->free_order[page_idx] = order + 1;
+  list_push_front (&pool->free_lists[order], block_elem (pool, page_idx));
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,172 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* An object cache ("slab allocator") for fixed-size kernel
+   objects.
+
+   Each cache carves pages from the page allocator, called
+   "slabs", into objects of a single size.  A slab starts with a
+   header and is followed by its objects.  Every object is
+   followed by a pointer that links it into its slab's free list
+   while it is free; keeping the link out of the object itself
+   means a free object keeps whatever state the cache's
+   constructor, or the object's last user, left in it.
+
+   Allocation takes an object from the first slab on the cache's
+   PARTIAL list, which holds every slab with a free object, and
+   takes a new page only if that list is empty.  A slab that
+   becomes full leaves the list, and rejoins it when one of its
+   objects is freed.  One completely free slab per cache is kept
+   around so that a single object allocated and freed over and
+   over does not bounce a page to and from the page allocator;
+   further empty slabs are given back.
+
+   Unlike malloc(), which rounds each request up to a power of 2,
+   objects here are packed at their own size, and freeing an
+   object never needs to search for the slab it belongs to. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* A slab: one page of objects. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct slab_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's PARTIAL list. */
+    size_t in_use;              /* Number of objects allocated. */
+    void *free;                 /* First free object, or null. */
+  };
+
+static struct slab *new_slab (struct slab_cache *);
+static void **free_link (struct slab_cache *, void *obj);
+
+/* Initializes CACHE for objects of SIZE bytes, which must be no
+   more than fits in a page with a slab header.  If CTOR is
+   non-null, it is called on each object when the object's slab
+   is created.  Objects must be returned to the cache with
+   slab_free() in the state that CTOR leaves them in. */
+void
+slab_cache_init (struct slab_cache *cache, const char *name, size_t size,
+                 slab_ctor_func *ctor)
+{
+  ASSERT (size > 0);
+
+  cache->name = name;
+  cache->obj_size = size;
+  cache->stride = ROUND_UP (size, sizeof (void *)) + sizeof (void *);
+  cache->objs_per_slab = (PGSIZE - sizeof (struct slab)) / cache->stride;
+  ASSERT (cache->objs_per_slab > 0);
+  cache->ctor = ctor;
+  list_init (&cache->partial);
+  cache->empty_cnt = 0;
+  lock_init (&cache->lock);
+}
+
+/* Obtains and returns a new object from CACHE.  Returns a null
+   pointer if memory is not available. */
+void *
+slab_alloc (struct slab_cache *cache)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&cache->lock);
+  if (list_empty (&cache->partial))
+    {
+      s = new_slab (cache);
+      if (s == NULL)
+        {
+          lock_release (&cache->lock);
+          return NULL;
+        }
+      list_push_front (&cache->partial, &s->elem);
+    }
+  else
+    {
+      s = list_entry (list_front (&cache->partial), struct slab, elem);
+      if (s->in_use == 0)
+        cache->empty_cnt--;
+    }
+
+  obj = s->free;
+  s->free = *free_link (cache, obj);
+  if (++s->in_use == cache->objs_per_slab)
+    list_remove (&s->elem);
+  lock_release (&cache->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from CACHE with
+   slab_alloc(), to CACHE.  A null OBJ is ignored. */
+void
+slab_free (struct slab_cache *cache, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == cache);
+  ASSERT ((pg_ofs (obj) - sizeof *s) % cache->stride == 0);
+
+  lock_acquire (&cache->lock);
+  ASSERT (s->in_use > 0);
+  *free_link (cache, obj) = s->free;
+  s->free = obj;
+  if (s->in_use-- == cache->objs_per_slab)
+    list_push_front (&cache->partial, &s->elem);
+  if (s->in_use == 0)
+    {
+      if (cache->empty_cnt > 0)
+        {
+          list_remove (&s->elem);
+          palloc_free_page (s);
+        }
+      else
+        cache->empty_cnt++;
+    }
+  lock_release (&cache->lock);
+}
+
+/* Takes a page from the page allocator and sets it up as a slab
+   for CACHE with every object free and constructed.  Returns the
+   new slab, or a null pointer if no page is available. */
+static struct slab *
+new_slab (struct slab_cache *cache)
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *obj;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = cache;
+  s->in_use = 0;
+  s->free = NULL;
+  obj = (uint8_t *) (s + 1) + (cache->objs_per_slab - 1) * cache->stride;
+  for (i = 0; i < cache->objs_per_slab; i++, obj -= cache->stride)
+    {
+      if (cache->ctor != NULL)
+        cache->ctor (obj);
+      *free_link (cache, obj) = s->free;
+      s->free = obj;
+    }
+  return s;
+}
+
+/* Returns the free-list link that follows OBJ in CACHE. */
+static void **
+free_link (struct slab_cache *cache, void *obj)
+{
+  return (void **) ((uint8_t *) obj + cache->stride - sizeof (void *));
+}
@@ -0,0 +1,31 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Constructor for the objects in a slab cache.  Runs once on
+   each object when the page holding it is taken from the page
+   allocator, not on every slab_alloc(). */
+typedef void slab_ctor_func (void *);
+
+/* A cache of objects of one type. */
+struct slab_cache
+  {
+    const char *name;           /* For debugging. */
+    size_t obj_size;            /* Size of an object in bytes. */
+    size_t stride;              /* Bytes from one object to the next. */
+    size_t objs_per_slab;       /* Objects in a one-page slab. */
+    slab_ctor_func *ctor;       /* Constructor, or a null pointer. */
+    struct list partial;        /* Slabs with at least one free object. */
+    size_t empty_cnt;           /* Slabs in PARTIAL with no objects in use. */
+    struct lock lock;           /* Protects the members above. */
+  };
+
+void slab_cache_init (struct slab_cache *, const char *name, size_t size,
+                      slab_ctor_func *);
+void *slab_alloc (struct slab_cache *);
+void slab_free (struct slab_cache *, void *);
+
+#endif /* threads/slab.h */
@@ -511,6 +511,11 @@ idle (void *idle_started_ UNUSED)
 
   for (;;) 
     {
+      /* Zero free pages for palloc while there is nothing else
+         to do. */
+      while (list_empty (&ready_list) && palloc_prezero ())
+        continue;
+
       /* Let someone else run. */
       intr_disable ();
       thread_block ();
@@ -594,7 +599,7 @@ init_thread (struct thread *t, const char *name, int priority)
   #ifdef USERPROG 
     t->pcb = NULL;
     list_init(&t->child_list);
-    list_init(&t->file_descriptors);
+    fd_table_init(&t->fd_table);
     t->executing_file = NULL;
   #endif
 #ifdef VM
@@ -7,6 +7,10 @@
 #include <threads/synch.h> /* Project #3 */
 #ifdef VM
 #include <vm/page.h>       /* Project #4 */
+#include <vmstat.h>
+#endif
+#ifdef USERPROG
+#include "userprog/fdtable.h"
 #endif
 
 /* States in a thread's life cycle. */
@@ -115,12 +119,13 @@ struct thread
     struct file *executing_file;
     struct process_control_block *pcb; 
     struct list child_list;            
-    struct list file_descriptors;      
+    struct fd_table fd_table;          /* Open files, indexed by fd. */
     uint8_t *current_esp;              
 #endif
 #ifdef VM
    struct vm_page_table *supt;  /* Supplemental Page Table*/
    struct list mmap_list;                 /* List of mmap descriptors*/
+   struct vm_stat vm_stat;                /* Per-process VM counters. */
 #endif
 
    struct dir* cwd;
@@ -0,0 +1,138 @@
+#include "userprog/elfcache.h"
+#include <debug.h>
+#include "devices/block.h"
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/synch.h"
+
+/* Number of executables whose metadata is kept. */
+#define ELFCACHE_SIZE 16
+
+/* Parsed metadata for one executable, identified by its inode
+   number so that it outlives every open of the file. */
+struct elfcache_entry
+  {
+    bool in_use;                /* Does this entry hold an image? */
+    block_sector_t inumber;     /* Inode of the executable. */
+    unsigned last_use;          /* CLOCK when last looked up. */
+    struct elf_image image;     /* The executable's metadata. */
+  };
+
+static struct elfcache_entry entries[ELFCACHE_SIZE];
+static unsigned clock;          /* Ticks once per lookup or insert. */
+static unsigned generation;     /* Ticks once per invalidation. */
+static struct lock elfcache_lock;
+
+static struct elfcache_entry *find (block_sector_t inumber);
+
+/* Initializes the executable cache. */
+void
+elfcache_init (void)
+{
+  lock_init (&elfcache_lock);
+}
+
+/* If FILE's executable header and program headers have been
+   parsed since FILE was last written, copies the result into
+   *IMAGE and returns true.  Otherwise returns false. */
+bool
+elfcache_lookup (struct file *file, struct elf_image *image)
+{
+  struct elfcache_entry *e;
+
+  lock_acquire (&elfcache_lock);
+  e = find (inode_get_inumber (file_get_inode (file)));
+  if (e != NULL)
+    {
+      e->last_use = ++clock;
+      *image = e->image;
+    }
+  lock_release (&elfcache_lock);
+  return e != NULL;
+}
+
+/* Returns the number of invalidations so far.  A caller that
+   reads this before opening a file, and later passes it to
+   elfcache_insert(), cannot cache metadata for a file that was
+   removed or written in between. */
+unsigned
+elfcache_generation (void)
+{
+  unsigned gen;
+
+  lock_acquire (&elfcache_lock);
+  gen = generation;
+  lock_release (&elfcache_lock);
+  return gen;
+}
+
+/* Remembers IMAGE as FILE's metadata, replacing the entry that
+   was used least recently if the cache is full.  Does nothing if
+   any entry has been invalidated since elfcache_generation()
+   returned GEN. */
+void
+elfcache_insert (struct file *file, const struct elf_image *image,
+                 unsigned gen)
+{
+  block_sector_t inumber = inode_get_inumber (file_get_inode (file));
+  struct elfcache_entry *e;
+
+  ASSERT (image->segment_cnt >= 0 && image->segment_cnt <= ELF_SEGMENT_MAX);
+
+  lock_acquire (&elfcache_lock);
+  if (gen != generation)
+    {
+      lock_release (&elfcache_lock);
+      return;
+    }
+  e = find (inumber);
+  if (e == NULL)
+    {
+      struct elfcache_entry *victim = &entries[0];
+      for (e = entries; e < entries + ELFCACHE_SIZE; e++)
+        if (!e->in_use)
+          {
+            victim = e;
+            break;
+          }
+        else if (e->last_use < victim->last_use)
+          victim = e;
+      e = victim;
+    }
+  e->in_use = true;
+  e->inumber = inumber;
+  e->last_use = ++clock;
+  e->image = *image;
+  lock_release (&elfcache_lock);
+}
+
+/* Drops any metadata cached for INODE.  Must be called whenever
+   INODE's data may have changed. */
+void
+elfcache_invalidate (struct inode *inode)
+{
+  struct elfcache_entry *e;
+
+  if (inode == NULL)
+    return;
+  lock_acquire (&elfcache_lock);
+  generation++;
+  e = find (inode_get_inumber (inode));
+  if (e != NULL)
+    e->in_use = false;
+  lock_release (&elfcache_lock);
+}
+
+/* Returns the entry for INUMBER, or a null pointer if there is
+   none.  The caller must hold elfcache_lock. */
+static struct elfcache_entry *
+find (block_sector_t inumber)
+{
+  struct elfcache_entry *e;
+
+  ASSERT (lock_held_by_current_thread (&elfcache_lock));
+  for (e = entries; e < entries + ELFCACHE_SIZE; e++)
+    if (e->in_use && e->inumber == inumber)
+      return e;
+  return NULL;
+}
@@ -0,0 +1,42 @@
+#ifndef USERPROG_ELFCACHE_H
+#define USERPROG_ELFCACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+struct file;
+struct inode;
+
+/* Most loadable segments an elf_image holds.  load() does not
+   cache executables with more, and loads them straight from their
+   program headers instead. */
+#define ELF_SEGMENT_MAX 16
+
+/* A loadable segment, already validated, in the form that
+   load_segment() takes. */
+struct elf_segment
+  {
+    uint32_t file_page;         /* Page-aligned offset in the file. */
+    uint32_t mem_page;          /* Page-aligned user virtual address. */
+    uint32_t read_bytes;        /* Bytes to read from the file. */
+    uint32_t zero_bytes;        /* Bytes to zero after them. */
+    bool writable;              /* Mapped writable? */
+  };
+
+/* What load() needs to know about an executable. */
+struct elf_image
+  {
+    uint32_t entry;                             /* Entry point. */
+    int segment_cnt;                            /* Number of segments,
+                                                   or -1 if too many. */
+    struct elf_segment segments[ELF_SEGMENT_MAX];
+  };
+
+void elfcache_init (void);
+bool elfcache_lookup (struct file *, struct elf_image *);
+unsigned elfcache_generation (void);
+void elfcache_insert (struct file *, const struct elf_image *,
+                      unsigned gen);
+void elfcache_invalidate (struct inode *);
+
+#endif /* userprog/elfcache.h */
@@ -112,9 +112,15 @@ page_fault (struct intr_frame *f)
       expand_stack(curr->supt, fault_page);
       handle_mm_fault(curr->supt, curr->pagedir, fault_page);
     }
-    else{
+    else if (user || !is_user_vaddr(fault_addr)) {
       sys_exit(-1);
     }
+    else {
+      /* The kernel followed a bad user pointer.  Recover below,
+         so that the copy routine that faulted returns failure and
+         its caller can clean up before killing the process. */
+      goto PAGE_FAULT_VIOLATED_ACCESS;
+    }
     // success
     return;
   }
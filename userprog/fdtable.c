@@ -0,0 +1,151 @@
+#include "userprog/fdtable.h"
+#include <bitmap.h>
+#include <debug.h>
+#include "threads/malloc.h"
+
+/* Number of descriptors reserved for the console. */
+#define FD_RESERVED 3
+
+/* Number of slots in a table when its first file is opened. */
+#define FD_TABLE_INITIAL_SIZE 16
+
+static bool grow (struct fd_table *);
+
+/* Initializes T as an empty table.  Nothing is allocated until
+   the first descriptor is installed, so threads that never open
+   a file pay nothing. */
+void
+fd_table_init (struct fd_table *t)
+{
+  t->slots = NULL;
+  t->size = 0;
+  t->used = NULL;
+}
+
+/* Frees the memory held by T, which must have no descriptors
+   left in it, and leaves it empty. */
+void
+fd_table_destroy (struct fd_table *t)
+{
+  ASSERT (t->used == NULL
+          || bitmap_count (t->used, FD_RESERVED, t->size - FD_RESERVED,
+                           true) == 0);
+  free (t->slots);
+  if (t->used != NULL)
+    bitmap_destroy (t->used);
+  fd_table_init (t);
+}
+
+/* Installs FD in T under the lowest free descriptor number and
+   returns that number, or -1 if memory is not available. */
+int
+fd_table_install (struct fd_table *t, struct fd_struct *fd)
+{
+  size_t idx = BITMAP_ERROR;
+
+  if (t->used != NULL)
+    idx = bitmap_scan_and_flip (t->used, FD_RESERVED, 1, false);
+  if (idx == BITMAP_ERROR)
+    {
+      idx = t->size > FD_RESERVED ? t->size : FD_RESERVED;
+      if (!grow (t))
+        return -1;
+      bitmap_mark (t->used, idx);
+    }
+
+  t->slots[idx] = fd;
+  return idx;
+}
+
+/* Installs FD in T under descriptor number NUM, which must be
+   free and not reserved.  Returns true if successful, false if
+   memory is not available. */
+bool
+fd_table_install_at (struct fd_table *t, int num, struct fd_struct *fd)
+{
+  ASSERT (num >= FD_RESERVED);
+
+  while ((size_t) num >= t->size)
+    if (!grow (t))
+      return false;
+  ASSERT (!bitmap_test (t->used, num));
+
+  bitmap_mark (t->used, num);
+  t->slots[num] = fd;
+  return true;
+}
+
+/* Returns descriptor FD in T, or a null pointer if FD is not
+   open. */
+struct fd_struct *
+fd_table_get (struct fd_table *t, int fd)
+{
+  if (fd < FD_RESERVED || (size_t) fd >= t->size)
+    return NULL;
+  return t->slots[fd];
+}
+
+/* Removes descriptor FD from T and returns it, or returns a null
+   pointer if FD is not open.  The number becomes free for
+   fd_table_install() to hand out again. */
+struct fd_struct *
+fd_table_remove (struct fd_table *t, int fd)
+{
+  struct fd_struct *desc = fd_table_get (t, fd);
+
+  if (desc != NULL)
+    {
+      t->slots[fd] = NULL;
+      bitmap_reset (t->used, fd);
+    }
+  return desc;
+}
+
+/* Removes and returns some open descriptor in T, or returns a
+   null pointer if T has none.  For closing every file when a
+   process exits. */
+struct fd_struct *
+fd_table_pop (struct fd_table *t)
+{
+  size_t idx;
+
+  if (t->used == NULL)
+    return NULL;
+  idx = bitmap_scan (t->used, FD_RESERVED, 1, true);
+  return idx != BITMAP_ERROR ? fd_table_remove (t, idx) : NULL;
+}
+
+/* Doubles the number of slots in T, or creates the first ones.
+   Returns true if successful, false if out of memory. */
+static bool
+grow (struct fd_table *t)
+{
+  size_t new_size = t->size > 0 ? t->size * 2 : FD_TABLE_INITIAL_SIZE;
+  struct fd_struct **slots;
+  struct bitmap *used;
+  size_t i;
+
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  slots = realloc (t->slots, new_size * sizeof *slots);
+  if (slots == NULL)
+    {
+      bitmap_destroy (used);
+      return false;
+    }
+
+  bitmap_set_multiple (used, 0, FD_RESERVED, true);
+  for (i = 0; i < new_size; i++)
+    if (i >= t->size)
+      slots[i] = NULL;
+    else if (bitmap_test (t->used, i))
+      bitmap_mark (used, i);
+  if (t->used != NULL)
+    bitmap_destroy (t->used);
+
+  t->slots = slots;
+  t->used = used;
+  t->size = new_size;
+  return true;
+}
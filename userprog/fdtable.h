@@ -0,0 +1,27 @@
+#ifndef USERPROG_FDTABLE_H
+#define USERPROG_FDTABLE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct fd_struct;
+
+/* A process's open file descriptors, indexed by descriptor
+   number.  Descriptors 0, 1 and 2 are reserved for the console
+   and are never handed out. */
+struct fd_table
+  {
+    struct fd_struct **slots;   /* Descriptor I, or a null pointer. */
+    size_t size;                /* Number of elements in SLOTS. */
+    struct bitmap *used;        /* Which elements of SLOTS are in use. */
+  };
+
+void fd_table_init (struct fd_table *);
+void fd_table_destroy (struct fd_table *);
+int fd_table_install (struct fd_table *, struct fd_struct *);
+bool fd_table_install_at (struct fd_table *, int fd, struct fd_struct *);
+struct fd_struct *fd_table_get (struct fd_table *, int fd);
+struct fd_struct *fd_table_remove (struct fd_table *, int fd);
+struct fd_struct *fd_table_pop (struct fd_table *);
+
+#endif /* userprog/fdtable.h */
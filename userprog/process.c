@@ -9,6 +9,7 @@
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "userprog/syscall.h"
+#include "userprog/elfcache.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
@@ -27,42 +28,155 @@
 #define vm_frame_free(x) palloc_free_page(x)
 #endif
 
+/* Caches for process control blocks and file descriptors, which
+   would otherwise take a whole page each. */
+static struct slab_cache pcb_cache;
+struct slab_cache fd_cache;
+
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static pid_t create_process (char *args, int argc, struct fd_struct **fds,
+                             int fd_cnt, bool wait_load);
+static void close_fd (struct fd_struct *);
+static void close_fds (struct fd_struct **fds, int fd_cnt);
+static bool load (const char *cmdline, struct file *, unsigned elfcache_gen,
+                  void (**eip) (void), void **esp);
+
+/* Sets up the object caches used by processes. */
+void
+process_init (void)
+{
+  slab_cache_init (&pcb_cache, "pcb", sizeof (struct process_control_block),
+                   NULL);
+  slab_cache_init (&fd_cache, "fd", sizeof (struct fd_struct), NULL);
+  elfcache_init ();
+}
 
+/* Starts a new process running the command line FILE_NAME and
+   waits for it to load.  Returns its pid, or PID_ERROR if it
+   could not be created or loaded. */
 pid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy = NULL;
+  char *fn_copy = palloc_get_page (0);
+  if (fn_copy == NULL)
+    return PID_ERROR;
+  strlcpy (fn_copy, file_name, PGSIZE);
+  return create_process (fn_copy, -1, NULL, 0, true);
+}
+
+/* Starts a new process with the ARGC arguments stored back to
+   back, each null-terminated, in the page ARGS, and returns its
+   pid without waiting for it to load.  The arguments reach the
+   child's main() exactly as given.  If the load fails, the child
+   exits with status -1.  The child gets a copy of each of the
+   current process's descriptors named in the FD_CNT elements of
+   MAP.  Takes ownership of ARGS.  Returns PID_ERROR if the process
+   could not be created or MAP is invalid. */
+pid_t
+process_spawn (char *args, int argc, const struct spawn_fd *map, int fd_cnt)
+{
+  struct thread *cur = thread_current ();
+  struct fd_struct **fds = NULL;
+  int i, j;
+
+  ASSERT (argc > 0);
+
+  if (fd_cnt < 0 || fd_cnt > SPAWN_FD_MAX)
+    {
+      palloc_free_page (args);
+      return PID_ERROR;
+    }
+  if (fd_cnt > 0)
+    {
+      fds = malloc (fd_cnt * sizeof *fds);
+      if (fds == NULL)
+        {
+          palloc_free_page (args);
+          return PID_ERROR;
+        }
+    }
+
+  for (i = 0; i < fd_cnt; i++)
+    {
+      struct fd_struct *parent = fd_table_get (&cur->fd_table,
+                                               map[i].parent_fd);
+      struct fd_struct *child;
+
+      for (j = 0; j < i; j++)
+        if (map[j].child_fd == map[i].child_fd)
+          break;
+      if (parent == NULL || j < i
+          || map[i].child_fd < 3 || map[i].child_fd >= SPAWN_FD_LIMIT)
+        goto failed;
+
+      child = slab_alloc (&fd_cache);
+      if (child == NULL)
+        goto failed;
+      child->id = map[i].child_fd;
+      child->file = file_reopen (parent->file);
+      child->dir = parent->dir != NULL ? dir_reopen (parent->dir) : NULL;
+      fds[i] = child;
+      if (child->file == NULL || (parent->dir != NULL && child->dir == NULL))
+        {
+          i++;
+          goto failed;
+        }
+    }
+  return create_process (args, argc, fds, fd_cnt, false);
+
+ failed:
+  close_fds (fds, i);
+  palloc_free_page (args);
+  return PID_ERROR;
+}
+
+/* Common code for process_execute() and process_spawn().  ARGS
+   is a page holding either a command line to split at spaces, if
+   ARGC is negative, or ARGC null-terminated arguments back to
+   back.  Takes ownership of ARGS. */
+static pid_t
+create_process (char *args, int argc, struct fd_struct **fds, int fd_cnt,
+                bool wait_load)
+{
+  char *fn_copy = args;
   char *cmd_copy = NULL;
   struct process_control_block *pcb = NULL;
+  struct file *file = NULL;
+  unsigned elfcache_gen;
   tid_t tid;
   char *save_ptr = NULL;
 
-  fn_copy = palloc_get_page (0);
-  if (fn_copy == NULL)
-    goto failed;
-  strlcpy (fn_copy, file_name, PGSIZE);
-  
   cmd_copy = palloc_get_page(0);
   if(cmd_copy == NULL)
     goto failed;
-  strlcpy(cmd_copy,file_name,PGSIZE);
-  cmd_copy = strtok_r(cmd_copy," ",&save_ptr);
+  strlcpy(cmd_copy,args,PGSIZE);
+  if(argc < 0){
+    cmd_copy = strtok_r(cmd_copy," ",&save_ptr);
 
-  for(int i=0;i<strlen(cmd_copy);i++){
-    if(cmd_copy[i]==' ')
-      cmd_copy[i]='\0';
+    for(int i=0;i<strlen(cmd_copy);i++){
+      if(cmd_copy[i]==' ')
+        cmd_copy[i]='\0';
+    }
   }
-  if(filesys_open(cmd_copy)==NULL)
-    return -1;
+  /* The child loads from this open file instead of opening it
+     again. */
+  elfcache_gen = elfcache_generation();
+  file = filesys_open(cmd_copy);
+  if(file == NULL)
+    goto failed;
   
-  pcb = palloc_get_page(0);
+  pcb = slab_alloc(&pcb_cache);
   if(pcb == NULL)
     goto failed;
   pcb -> pid = PID_INIT;
   pcb -> parent_thread = thread_current();
   pcb -> cmdline = fn_copy;
+  pcb -> argc = argc;
+  pcb -> executable = file;
+  pcb -> elfcache_gen = elfcache_gen;
+  pcb -> inherited = fds;
+  pcb -> inherited_cnt = fd_cnt;
+  pcb -> async_load = !wait_load;
   pcb -> waiting = false;
   pcb -> exited = false;
   pcb -> orphan = false;
@@ -77,7 +191,10 @@ process_execute (const char *file_name)
   if (tid == TID_ERROR)
     goto failed;
   
-  sema_down(&pcb->sema_init);
+  if(wait_load)
+    sema_down(&pcb->sema_init);
+  else
+    pcb->pid = tid;
 
   if(cmd_copy){
     palloc_free_page(cmd_copy);
@@ -94,14 +211,35 @@ failed:
     palloc_free_page(cmd_copy);
   if(fn_copy)
     palloc_free_page(fn_copy);
-  if(pcb){
-    palloc_free_page(pcb->cmdline);
-    palloc_free_page(pcb);
-  }
+  if(file)
+    file_close(file);
+  close_fds(fds, fd_cnt);
+  slab_free(&pcb_cache, pcb);
 
   return PID_ERROR;
 }
 
+/* Closes FD, which is in no descriptor table, and frees it. */
+static void
+close_fd (struct fd_struct *fd)
+{
+  file_close (fd->file);
+  if (fd->dir)
+    dir_close (fd->dir);
+  slab_free (&fd_cache, fd);
+}
+
+/* Closes the FD_CNT descriptors in FDS and frees FDS. */
+static void
+close_fds (struct fd_struct **fds, int fd_cnt)
+{
+  int i;
+
+  for (i = 0; i < fd_cnt; i++)
+    close_fd (fds[i]);
+  free (fds);
+}
+
 
 
 static void
@@ -112,17 +250,41 @@ start_process (void *pcb_)
 
   char *file_name = (char*) pcb->cmdline;
   bool success = false;
+  int i;
+
+  /* Take over the descriptors passed down by spawn. */
+  for (i = 0; i < pcb->inherited_cnt; i++)
+    {
+      struct fd_struct *fd = pcb->inherited[i];
+      if (!fd_table_install_at (&t->fd_table, fd->id, fd))
+        close_fd (fd);
+    }
+  free (pcb->inherited);
+  pcb->inherited = NULL;
+  pcb->inherited_cnt = 0;
 
   
   const char **parsed_filename_argv = (const char**) palloc_get_page(0);
 
   if (parsed_filename_argv == NULL) {
     printf("Not enough memory\n");
-    
+    file_close (pcb->executable);
     goto finish; 
   }
   int argc=0;
-  argc=parse_file_name(file_name,parsed_filename_argv);
+  if (pcb->argc < 0)
+    argc=parse_file_name(file_name,parsed_filename_argv);
+  else
+    {
+      /* Arguments from spawn are already separate strings. */
+      char *arg = file_name;
+      for (argc = 0; argc < pcb->argc; argc++)
+        {
+          parsed_filename_argv[argc] = arg;
+          arg += strlen (arg) + 1;
+        }
+    }
+  parsed_filename_argv[argc] = NULL;
   
 
   
@@ -131,14 +293,24 @@ start_process (void *pcb_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  /* exec's parent holds file_system_lock until the load is done,
+     but spawn's has already returned. */
+  if (pcb->async_load)
+    lock_acquire (&file_system_lock);
+  success = load (file_name, pcb->executable, pcb->elfcache_gen,
+                  &if_.eip, &if_.esp);
+  if (pcb->async_load)
+    lock_release (&file_system_lock);
   if (success) {
     push_userstack(parsed_filename_argv, argc,&if_.esp);
   }
   palloc_free_page (parsed_filename_argv);
 
 finish:
-  pcb->pid = success ? (pid_t)(t->tid) : PID_ERROR;
+  /* A spawned child's parent already has its pid, and learns of a
+     failed load from its exit status. */
+  if (!pcb->async_load)
+    pcb->pid = success ? (pid_t)(t->tid) : PID_ERROR;
   t->pcb = pcb;
   sema_up(&pcb->sema_init);
 
@@ -215,7 +387,7 @@ process_wait (tid_t child_tid)
 
   int ret = child_pcb->exitcode;
 
-  palloc_free_page(child_pcb);
+  slab_free(&pcb_cache, child_pcb);
 
   return ret;
 }
@@ -229,13 +401,12 @@ process_exit (void)
   if(cur->cwd!=NULL){
     dir_close(cur->cwd);
   }
-  struct list *fdlist = &cur->file_descriptors;
-  while (!list_empty(fdlist)) {
-    struct list_elem *cur_e = list_pop_front (fdlist);
-    struct fd_struct *fd_ptr = list_entry(cur_e, struct fd_struct, elem);
+  struct fd_struct *fd_ptr;
+  while ((fd_ptr = fd_table_pop (&cur->fd_table)) != NULL) {
     file_close(fd_ptr->file);
-    palloc_free_page(fd_ptr); 
+    slab_free(&fd_cache, fd_ptr);
   }
+  fd_table_destroy (&cur->fd_table);
 
   struct list *pcb_list  = &cur -> child_list;
   while(!list_empty(pcb_list)){
@@ -247,8 +418,8 @@ process_exit (void)
       cur_pcb->parent_thread = NULL;
     }
     else{
-      palloc_free_page(cur_pcb->cmdline);
-      palloc_free_page(cur_pcb);
+      palloc_free_page((void *) cur_pcb->cmdline);
+      slab_free(&pcb_cache, cur_pcb);
     }
   }
 
@@ -265,7 +436,8 @@ process_exit (void)
   bool cur_orphan = cur->pcb->orphan;
   sema_up (&cur->pcb->sema_wait);
   if (cur_orphan) {
-    palloc_free_page (& cur->pcb);
+    palloc_free_page ((void *) cur->pcb->cmdline);
+    slab_free (&pcb_cache, cur->pcb);
   }
 
 #ifdef VM
@@ -361,20 +533,163 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* What read_phdr() found in a program header. */
+enum phdr_kind
+  {
+    PHDR_IGNORE,                /* Nothing to load. */
+    PHDR_LOAD,                  /* A valid loadable segment. */
+    PHDR_BAD                    /* Unreadable or not loadable here. */
+  };
+
+/* Reads the program header at FILE_OFS in FILE.  If it describes
+   a valid loadable segment, stores the segment into *SEG and
+   returns PHDR_LOAD. */
+static enum phdr_kind
+read_phdr (struct file *file, off_t file_ofs, struct elf_segment *seg)
+{
+  struct Elf32_Phdr phdr;
+  uint32_t page_offset;
+
+  if (file_ofs < 0 || file_ofs > file_length (file))
+    return PHDR_BAD;
+  file_seek (file, file_ofs);
+
+  if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
+    return PHDR_BAD;
+  switch (phdr.p_type)
+    {
+    case PT_NULL:
+    case PT_NOTE:
+    case PT_PHDR:
+    case PT_STACK:
+    default:
+      return PHDR_IGNORE;
+    case PT_DYNAMIC:
+    case PT_INTERP:
+    case PT_SHLIB:
+      return PHDR_BAD;
+    case PT_LOAD:
+      if (!validate_segment (&phdr, file))
+        return PHDR_BAD;
+      break;
+    }
+
+  page_offset = phdr.p_vaddr & PGMASK;
+  seg->writable = (phdr.p_flags & PF_W) != 0;
+  seg->file_page = phdr.p_offset & ~PGMASK;
+  seg->mem_page = phdr.p_vaddr & ~PGMASK;
+  if (phdr.p_filesz > 0)
+    {
+      seg->read_bytes = page_offset + phdr.p_filesz;
+      seg->zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
+                         - seg->read_bytes);
+    }
+  else
+    {
+      seg->read_bytes = 0;
+      seg->zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
+    }
+  return PHDR_LOAD;
+}
+
+/* Reads FILE's executable header into *EHDR and its program
+   headers into *IMAGE, validating each loadable segment.  If FILE
+   has more than ELF_SEGMENT_MAX loadable segments, sets
+   IMAGE->segment_cnt to -1; load_segments() then loads them
+   straight from the program headers.  Returns true if successful,
+   false if FILE is not an executable that this kernel can load. */
+static bool
+read_elf_image (struct file *file, struct Elf32_Ehdr *ehdr,
+                struct elf_image *image)
+{
+  int i;
+
+  /* Read and verify executable header. */
+  file_seek (file, 0);
+  if (file_read (file, ehdr, sizeof *ehdr) != sizeof *ehdr
+      || memcmp (ehdr->e_ident, "\177ELF\1\1\1", 7)
+      || ehdr->e_type != 2
+      || ehdr->e_machine != 3
+      || ehdr->e_version != 1
+      || ehdr->e_phentsize != sizeof (struct Elf32_Phdr)
+      || ehdr->e_phnum > 1024)
+    return false;
+
+  image->entry = ehdr->e_entry;
+  image->segment_cnt = 0;
+  for (i = 0; i < ehdr->e_phnum; i++)
+    {
+      off_t file_ofs = ehdr->e_phoff + i * sizeof (struct Elf32_Phdr);
+      struct elf_segment seg;
+
+      switch (read_phdr (file, file_ofs, &seg))
+        {
+        case PHDR_IGNORE:
+          break;
+        case PHDR_BAD:
+          return false;
+        case PHDR_LOAD:
+          if (image->segment_cnt < 0)
+            break;
+          if (image->segment_cnt < ELF_SEGMENT_MAX)
+            image->segments[image->segment_cnt++] = seg;
+          else
+            image->segment_cnt = -1;
+          break;
+        }
+    }
+  return true;
+}
+
+/* Loads every loadable segment of FILE, whose executable header
+   read_elf_image() stored in *EHDR, for executables with too many
+   segments to cache. */
+static bool
+load_segments (struct file *file, const struct Elf32_Ehdr *ehdr)
+{
+  int i;
+
+  for (i = 0; i < ehdr->e_phnum; i++)
+    {
+      off_t file_ofs = ehdr->e_phoff + i * sizeof (struct Elf32_Phdr);
+      struct elf_segment seg;
+
+      switch (read_phdr (file, file_ofs, &seg))
+        {
+        case PHDR_IGNORE:
+          break;
+        case PHDR_BAD:
+          return false;
+        case PHDR_LOAD:
+          if (!load_segment (file, seg.file_page, (void *) seg.mem_page,
+                             seg.read_bytes, seg.zero_bytes, seg.writable))
+            return false;
+          break;
+        }
+    }
+  return true;
+}
+
+/* Loads the ELF executable FILE, named FILE_NAME, into the
+   current thread, taking ownership of FILE.  ELFCACHE_GEN is
+   elfcache_generation() from before FILE was opened.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp)
+load (const char *file_name, struct file *file, unsigned elfcache_gen,
+      void (**eip) (void), void **esp)
 {
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
-  struct file *file = NULL;
-  off_t file_ofs;
+  struct elf_image image;
   bool success = false;
   int i;
 
+  /* Deny writes to executables.  Doing so before reading the
+     headers also keeps them from changing under the cache. */
+  file_deny_write (file);
+
   /* Allocate and activate page directory, as well as SPTE. */
   t->pagedir = pagedir_create ();
 #ifdef VM
@@ -385,81 +700,27 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
-  /* Open executable file. */
-  file = filesys_open (file_name);
-  if (file == NULL)
-    {
-      printf ("load: %s: open failed\n", file_name);
-      goto done;
-    }
-
-  /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
-      || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
-      || ehdr.e_type != 2
-      || ehdr.e_machine != 3
-      || ehdr.e_version != 1
-      || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
-      || ehdr.e_phnum > 1024)
+  /* Processes that run the same program share its parsed headers,
+     which stay valid until the file is next written. */
+  if (!elfcache_lookup (file, &image))
     {
-      printf ("load: %s: error loading executable\n", file_name);
-      goto done;
+      if (!read_elf_image (file, &ehdr, &image))
+        {
+          printf ("load: %s: error loading executable\n", file_name);
+          goto done;
+        }
+      if (image.segment_cnt >= 0)
+        elfcache_insert (file, &image, elfcache_gen);
+      else if (!load_segments (file, &ehdr))
+        goto done;
     }
 
-
-  file_ofs = ehdr.e_phoff;
-  for (i = 0; i < ehdr.e_phnum; i++)
+  for (i = 0; i < image.segment_cnt; i++)
     {
-      struct Elf32_Phdr phdr;
-
-      if (file_ofs < 0 || file_ofs > file_length (file))
+      struct elf_segment *seg = &image.segments[i];
+      if (!load_segment (file, seg->file_page, (void *) seg->mem_page,
+                         seg->read_bytes, seg->zero_bytes, seg->writable))
         goto done;
-      file_seek (file, file_ofs);
-
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
-      file_ofs += sizeof phdr;
-      switch (phdr.p_type)
-        {
-        case PT_NULL:
-        case PT_NOTE:
-        case PT_PHDR:
-        case PT_STACK:
-        default:
-          
-          break;
-        case PT_DYNAMIC:
-        case PT_INTERP:
-        case PT_SHLIB:
-          goto done;
-        case PT_LOAD:
-          if (validate_segment (&phdr, file))
-            {
-              bool writable = (phdr.p_flags & PF_W) != 0;
-              uint32_t file_page = phdr.p_offset & ~PGMASK;
-              uint32_t mem_page = phdr.p_vaddr & ~PGMASK;
-              uint32_t page_offset = phdr.p_vaddr & PGMASK;
-              uint32_t read_bytes, zero_bytes;
-              if (phdr.p_filesz > 0)
-                {
-                
-                  read_bytes = page_offset + phdr.p_filesz;
-                  zero_bytes = (ROUND_UP (page_offset + phdr.p_memsz, PGSIZE)
-                                - read_bytes);
-                }
-              else
-                {
-                  read_bytes = 0;
-                  zero_bytes = ROUND_UP (page_offset + phdr.p_memsz, PGSIZE);
-                }
-              if (!load_segment (file, file_page, (void *) mem_page,
-                                 read_bytes, zero_bytes, writable))
-                goto done;
-            }
-          else
-            goto done;
-          break;
-        }
     }
   t->cwd=dir_open_root();
   /* Set up stack. */
@@ -467,18 +728,18 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
 
   /* Start address. */
-  *eip = (void (*) (void)) ehdr.e_entry;
+  *eip = (void (*) (void)) image.entry;
 
-  /* Deny writes to executables. */
   thread_current()->executing_file = file;
-  file_deny_write (file);
 
   success = true;
 
  done:
+  if (!success)
+    file_close (file);
   return success;
 }
-
+
 /* load() helpers. */
 
 static bool install_page (void *upage, void *kpage, bool writable);
@@ -3,8 +3,10 @@
 #define INPUT_ARG_MAX 128
 #define WORD_SIZE 4
 #include <stdio.h>
+#include <spawn.h>
 #include "threads/thread.h"
 #include "threads/synch.h"
+#include "threads/slab.h"
 
 
 typedef int pid_t;
@@ -15,6 +17,16 @@ struct process_control_block {
     pid_t pid;
 
     const char *cmdline;
+    int argc;                   /* If nonnegative, CMDLINE holds ARGC
+                                   separate null-terminated arguments;
+                                   otherwise, it is split at spaces. */
+    struct file *executable;    /* Opened by the parent for load(). */
+    unsigned elfcache_gen;      /* elfcache_generation() before the
+                                   parent opened EXECUTABLE. */
+    struct fd_struct **inherited; /* Descriptors for the child to take
+                                     over, with their child numbers. */
+    int inherited_cnt;          /* Number of elements in INHERITED. */
+    bool async_load;            /* Parent did not wait for load()? */
 
     struct list_elem elem;
     struct thread *parent_thread;
@@ -30,7 +42,6 @@ struct process_control_block {
 struct fd_struct {
     int id;
     struct dir* dir;
-    struct list_elem elem;
     struct file* file;
 };
 
@@ -47,11 +58,17 @@ struct mmap_desc {
 };
 #endif
 
+/* Cache that every struct fd_struct comes from. */
+extern struct slab_cache fd_cache;
+
+void process_init (void);
 struct process_control_block *find_child_process(pid_t pid);
 void push_userstack(const char** parsed_filename_argv, int argc,void **esp);
 int parse_file_name(char *input, const char **parsed_filename_argv);
 
 pid_t process_execute (const char *file_name);
+pid_t process_spawn (char *args, int argc, const struct spawn_fd *,
+                     int fd_cnt);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
@@ -1,9 +1,13 @@
 #include "devices/shutdown.h"
 #include "devices/input.h"
+#include "devices/block.h"
+#include "devices/timer.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
 #include "userprog/syscall.h"
 #include "userprog/process.h"
+#include "userprog/elfcache.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <syscall-nr.h>
@@ -13,19 +17,30 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#ifdef VM
+#include "vm/stat.h"
+#endif
 
 struct lock file_system_lock;
+#ifdef VM
+static struct slab_cache mmap_cache;
+#endif
 
-void check_user(const uint8_t *addr);
+static void check_user_buffer(const void *buffer, size_t size, bool writable);
 static int get_user(const uint8_t *addr);
-//static bool put_user(uint8_t *udst,uint8_t byte);
-static int read_user(void *src, void *dst, size_t bytes);
+static bool put_user(uint8_t *udst,uint8_t byte);
+static bool copy_from_user(void *dst, const void *usrc, size_t size);
+static bool copy_to_user(void *udst, const void *src, size_t size);
+static bool is_user_range(const void *uaddr, size_t size);
+static int strncpy_from_user(char *dst, const char *usrc, size_t size);
+static char *copy_in_string(const char *ustr);
+static char *copy_in_argv(const char **uargv, int *argc);
 static void syscall_handler (struct intr_frame *);
 
 static void is_invalid(void);
-static int memread_user (void *src, void *dst, size_t bytes);
 
 enum search_type { FD_FILE = 1, FD_DIRECTORY = 2 };
 static struct fd_struct* find_file_desc(struct thread *t,int fd, enum search_type);
@@ -52,25 +67,13 @@ static void fail_invalid_access(void) {
 }
 
 
-static int
-memread_user (void *src, void *dst, size_t bytes)
-{
-  int32_t value;
-  size_t i;
-  for(i=0; i<bytes; i++) {
-    value = get_user(src + i);
-    if(value == -1) // segfault or invalid memory access
-      fail_invalid_access();
-
-    *(char*)(dst + i) = value & 0xff;
-  }
-  return (int)bytes;
-}
-
 void
 syscall_init (void) 
 {
   lock_init(&file_system_lock);
+#ifdef VM
+  slab_cache_init(&mmap_cache, "mmap", sizeof(struct mmap_desc), NULL);
+#endif
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
 }
 
@@ -113,8 +116,9 @@ void sys_exit(int status){
   thread_exit();
 }
 
+/* CMD_LINE and the file names passed to the system calls below
+   are kernel copies made by syscall_handler(). */
 pid_t sys_exec(const char *cmd_line){
-  check_user((const uint8_t *)cmd_line);
   lock_acquire(&file_system_lock);
   pid_t pid = process_execute(cmd_line);
   lock_release(&file_system_lock);
@@ -124,10 +128,32 @@ int sys_wait(pid_t pid){
   return process_wait(pid);
 }
 
+/* Starts the program whose arguments are the null-terminated
+   array ARGV, giving it copies of the descriptors mapped by the
+   FD_CNT elements of FDS, and returns its pid as soon as it
+   exists.  wait() reports -1 if it fails to load.  The child's
+   main() receives ARGV unchanged. */
+pid_t sys_spawn(const char **argv, const struct spawn_fd *fds, int fd_cnt){
+  struct spawn_fd map[SPAWN_FD_MAX];
+  char *args;
+  int argc;
+  pid_t pid;
+
+  if(fd_cnt < 0 || fd_cnt > SPAWN_FD_MAX)
+    return PID_ERROR;
+  if(!copy_from_user(map, fds, fd_cnt * sizeof *map))
+    fail_invalid_access();
+  args = copy_in_argv(argv, &argc);
+  if(args == NULL)
+    return PID_ERROR;
+
+  lock_acquire(&file_system_lock);
+  pid = process_spawn(args, argc, map, fd_cnt);
+  lock_release(&file_system_lock);
+  return pid;
+}
+
 bool sys_create(const char *file_name, unsigned initial_size){
-  if(file_name==NULL||!is_user_vaddr(file_name))
-    sys_exit(-1);
-  check_user((const uint8_t*)file_name);
   lock_acquire(&file_system_lock);
   bool success = filesys_create(file_name,initial_size,false);
   lock_release(&file_system_lock);
@@ -135,10 +161,14 @@ bool sys_create(const char *file_name, unsigned initial_size){
 }
 
 bool sys_remove(const char *file_name){
-  if(file_name==NULL||!is_user_vaddr(file_name))
-    sys_exit(-1);
-  check_user((const uint8_t*)file_name);
   lock_acquire(&file_system_lock);
+  /* The file's inode sector may be reused by a new file, which
+     must not inherit its cached executable headers. */
+  struct file *file = filesys_open(file_name);
+  if(file != NULL){
+    elfcache_invalidate(file_get_inode(file));
+    file_close(file);
+  }
   bool success = filesys_remove(file_name);
   lock_release(&file_system_lock);
   return success;
@@ -147,11 +177,9 @@ bool sys_remove(const char *file_name){
 int sys_open(const char *file_name){
   struct fd_struct* fd;
   struct file *openfile;
-  if(file_name==NULL||!is_user_vaddr(file_name))
-    sys_exit(-1);  
-  check_user((const uint8_t*)file_name);
-  fd = palloc_get_page(0);
-  if(!fd) 
+  int ret = -1;
+  fd = slab_alloc(&fd_cache);
+  if(!fd)
     return -1;
 
   lock_acquire(&file_system_lock);
@@ -167,20 +195,19 @@ int sys_open(const char *file_name){
     }
     else 
       fd->dir = NULL;
-    struct list* fd_list = &thread_current()->file_descriptors;
-    if(list_empty(fd_list)){
-      fd->id = 3;
-    }
+    fd->id = fd_table_install(&thread_current()->fd_table, fd);
+    if(fd->id >= 0)
+      ret = fd->id;
     else{
-      fd->id = (list_entry(list_back(fd_list),struct fd_struct,elem)->id) + 1;
+      if(fd->dir)
+        dir_close(fd->dir);
+      file_close(openfile);
     }
-    list_push_back(fd_list,&(fd->elem));
-    lock_release(&file_system_lock);
-    return fd->id;
   }
-  palloc_free_page(fd);
+  if(ret < 0)
+    slab_free(&fd_cache, fd);
   lock_release(&file_system_lock);
-  return -1;
+  return ret;
 }
 
 int sys_filesize(int fd){
@@ -198,8 +225,7 @@ int sys_filesize(int fd){
 }
 
 int sys_read(int fd, void *buffer, unsigned size){
-  check_user((const uint8_t *)buffer);
-  check_user((const uint8_t *)buffer + size -1);
+  check_user_buffer(buffer, size, true);
 
   lock_acquire(&file_system_lock);
   int ret_value;
@@ -239,8 +265,7 @@ int sys_read(int fd, void *buffer, unsigned size){
 
 int sys_write(int fd, const void *buffer,unsigned size){
   int ret_value;
-  check_user((const uint8_t*)buffer);
-  check_user((const uint8_t*)buffer + size -1);
+  check_user_buffer(buffer, size, false);
 
   lock_acquire(&file_system_lock);
   if(fd == 1){
@@ -261,6 +286,8 @@ int sys_write(int fd, const void *buffer,unsigned size){
 #ifdef VM
       unpin_preloaded_pages(buffer, size);
 #endif
+      if(ret_value > 0)
+        elfcache_invalidate(file_get_inode(fd_ptr->file));
     }
     else{
       ret_value = -1;
@@ -270,6 +297,195 @@ int sys_write(int fd, const void *buffer,unsigned size){
   return ret_value;
 }
 
+/* Copies up to SIZE bytes from IN_FD's current position to OUT_FD's,
+   advancing both, and returns the number of bytes written.  The data
+   goes through a kernel page instead of a user buffer, so there is
+   nothing to check, preload or pin, and the caller makes one system
+   call for the whole copy instead of a read and a write per chunk.
+   The file system lock is dropped between pages so that other
+   processes are not shut out of the file system for a long copy. */
+int sys_copy_file_range(int in_fd, int out_fd, unsigned size){
+  struct fd_struct *in, *out;
+  void *page;
+  unsigned copied = 0;
+
+  lock_acquire(&file_system_lock);
+  in = find_file_desc(thread_current(), in_fd, FD_FILE);
+  out = find_file_desc(thread_current(), out_fd, FD_FILE);
+  lock_release(&file_system_lock);
+  if(in == NULL || out == NULL)
+    sys_exit(-1);
+
+  page = palloc_get_page(0);
+  if(page == NULL)
+    return -1;
+
+  while(copied < size){
+    unsigned chunk = size - copied < PGSIZE ? size - copied : PGSIZE;
+    int bytes_read, bytes_written;
+
+    lock_acquire(&file_system_lock);
+    bytes_read = file_read(in->file, page, chunk);
+    bytes_written = bytes_read > 0 ? file_write(out->file, page, bytes_read) : 0;
+    lock_release(&file_system_lock);
+
+    copied += bytes_written;
+    if(bytes_read <= 0 || bytes_written < bytes_read)
+      break;
+  }
+
+  palloc_free_page(page);
+  if(copied > 0)
+    elfcache_invalidate(file_get_inode(out->file));
+  return copied;
+}
+
+/* Returns true if SIZE bytes starting at byte OFFSET lie within
+   the range an off_t can address. */
+static bool valid_file_range(unsigned offset, unsigned size){
+  return offset <= INT32_MAX && size <= INT32_MAX - offset;
+}
+
+/* Reads SIZE bytes from FD at byte OFFSET into BUFFER without
+   moving FD's position, sparing random-access readers a separate
+   seek and its extra trip through the file system lock. */
+int sys_pread(int fd, void *buffer, unsigned size, unsigned offset){
+  struct fd_struct *fd_ptr;
+  int ret_value = -1;
+
+  check_user_buffer(buffer, size, true);
+  if(!valid_file_range(offset, size))
+    return -1;
+
+  lock_acquire(&file_system_lock);
+  fd_ptr = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fd_ptr == NULL){
+    lock_release(&file_system_lock);
+    sys_exit(-1);
+  }
+  if(fd_ptr->file){
+#ifdef VM
+    preload_and_pin_pages(buffer, size);
+#endif
+    ret_value = file_read_at(fd_ptr->file, buffer, size, offset);
+#ifdef VM
+    unpin_preloaded_pages(buffer, size);
+#endif
+  }
+  lock_release(&file_system_lock);
+  return ret_value;
+}
+
+/* Writes SIZE bytes from BUFFER to FD at byte OFFSET without
+   moving FD's position. */
+int sys_pwrite(int fd, const void *buffer, unsigned size, unsigned offset){
+  struct fd_struct *fd_ptr;
+  int ret_value = -1;
+
+  check_user_buffer(buffer, size, false);
+  if(!valid_file_range(offset, size))
+    return -1;
+
+  lock_acquire(&file_system_lock);
+  fd_ptr = find_file_desc(thread_current(), fd, FD_FILE);
+  if(fd_ptr == NULL){
+    lock_release(&file_system_lock);
+    sys_exit(-1);
+  }
+  if(fd_ptr->file){
+#ifdef VM
+    preload_and_pin_pages(buffer, size);
+#endif
+    ret_value = file_write_at(fd_ptr->file, buffer, size, offset);
+#ifdef VM
+    unpin_preloaded_pages(buffer, size);
+#endif
+    if(ret_value > 0)
+      elfcache_invalidate(file_get_inode(fd_ptr->file));
+  }
+  lock_release(&file_system_lock);
+  return ret_value;
+}
+
+/* Reads into (if WRITE is false) or writes from the IOVCNT buffers
+   described by the array at user address UIOV, in order, as if by
+   one read or write on FD.  The whole transfer takes the file
+   system lock once.  Stops after the first short transfer.
+   Returns the number of bytes transferred, or -1 if IOVCNT is out
+   of range or FD is not a file. */
+static int transfer_iov(int fd, const struct iovec *uiov, int iovcnt,
+                        bool write){
+  struct iovec iov[IOV_MAX];
+  struct fd_struct *fd_ptr = NULL;
+  bool console = write ? fd == 1 : fd == 0;
+  int total = 0;
+  int i;
+
+  if(iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+  if(!copy_from_user(iov, uiov, iovcnt * sizeof *iov))
+    fail_invalid_access();
+  for(i = 0; i < iovcnt; i++)
+    check_user_buffer(iov[i].iov_base, iov[i].iov_len, !write);
+
+  lock_acquire(&file_system_lock);
+  if(!console){
+    fd_ptr = find_file_desc(thread_current(), fd, FD_FILE);
+    if(fd_ptr == NULL){
+      lock_release(&file_system_lock);
+      sys_exit(-1);
+    }
+    if(fd_ptr->file == NULL){
+      lock_release(&file_system_lock);
+      return -1;
+    }
+  }
+
+  for(i = 0; i < iovcnt; i++){
+    uint8_t *buffer = iov[i].iov_base;
+    unsigned size = iov[i].iov_len;
+    int done;
+
+    if(size == 0)
+      continue;
+#ifdef VM
+    preload_and_pin_pages(buffer, size);
+#endif
+    if(console){
+      unsigned j;
+      if(write)
+        putbuf((const char *) buffer, size);
+      else
+        for(j = 0; j < size; j++)
+          buffer[j] = input_getc();
+      done = size;
+    }
+    else if(write)
+      done = file_write(fd_ptr->file, buffer, size);
+    else
+      done = file_read(fd_ptr->file, buffer, size);
+#ifdef VM
+    unpin_preloaded_pages(buffer, size);
+#endif
+
+    total += done;
+    if(done < (int) size)
+      break;
+  }
+  if(write && !console && total > 0)
+    elfcache_invalidate(file_get_inode(fd_ptr->file));
+  lock_release(&file_system_lock);
+  return total;
+}
+
+int sys_readv(int fd, const struct iovec *iov, int iovcnt){
+  return transfer_iov(fd, iov, iovcnt, false);
+}
+
+int sys_writev(int fd, const struct iovec *iov, int iovcnt){
+  return transfer_iov(fd, iov, iovcnt, true);
+}
+
 void sys_seek(int fd, unsigned position){
   lock_acquire(&file_system_lock);
   struct fd_struct* fd_ptr = find_file_desc(thread_current(),fd,FD_FILE);
@@ -301,8 +517,8 @@ void sys_close(int fd){
     file_close(fd_ptr->file);
     if(fd_ptr->dir)
       dir_close(fd_ptr->dir);
-    list_remove(&(fd_ptr->elem));
-    palloc_free_page(fd_ptr);
+    fd_table_remove(&thread_current()->fd_table, fd);
+    slab_free(&fd_cache, fd_ptr);
   }
   lock_release(&file_system_lock);
 }
@@ -351,7 +567,7 @@ mmapid_t sys_mmap(int fd, void *upage) {
   }
   else mid = 1;
 
-  struct mmap_desc *mmap_d = (struct mmap_desc*) malloc(sizeof(struct mmap_desc));
+  struct mmap_desc *mmap_d = slab_alloc(&mmap_cache);
   mmap_d->id = mid;
   mmap_d->file = f;
   mmap_d->addr = upage;
@@ -386,214 +602,336 @@ void sys_munmap(mmapid_t mid)
     }
     list_remove(& mmap_d->elem);
     file_close(mmap_d->file);
-    free(mmap_d);
+    slab_free(&mmap_cache, mmap_d);
   }
   lock_release (&file_system_lock);
 
   return ;
 }
+
+void sys_vmstat(struct vm_stat *proc, struct vm_stat *global)
+{
+  struct vm_stat snapshot;
+  if(proc != NULL){
+    vm_stat_get(&snapshot, false);
+    if(!copy_to_user(proc, &snapshot, sizeof snapshot))
+      fail_invalid_access();
+  }
+  if(global != NULL){
+    vm_stat_get(&snapshot, true);
+    if(!copy_to_user(global, &snapshot, sizeof snapshot))
+      fail_invalid_access();
+  }
+}
+#endif
+
+bool sys_blockstat(int role, struct block_stat *stat)
+{
+  struct block_stat snapshot;
+
+  if(role < 0 || role >= BLOCK_ROLE_CNT || !block_get_stat(role, &snapshot))
+    return false;
+  if(!copy_to_user(stat, &snapshot, sizeof snapshot))
+    fail_invalid_access();
+  return true;
+}
+
+/* How syscall_handler() decodes a system call argument. */
+enum arg_kind
+  {
+    ARG_VALUE,                  /* Passed through as is. */
+    ARG_USER_PTR,               /* Must point below PHYS_BASE. */
+    ARG_STRING                  /* String copied into a kernel page. */
+  };
+
+/* Most arguments any system call takes. */
+#define SYSCALL_ARGS_MAX 4
+
+/* Handler for a system call, given its decoded arguments.
+   Returns the value for EAX. */
+typedef uint32_t syscall_func (const uint32_t args[]);
+
+/* A system call. */
+struct syscall
+  {
+    const char *name;                   /* For statistics. */
+    syscall_func *func;                 /* Handler. */
+    uint8_t argc;                       /* Number of arguments. */
+    enum arg_kind args[SYSCALL_ARGS_MAX]; /* Kind of each argument. */
+    uint32_t error;                     /* Result if an ARG_STRING is too
+                                           long for a page. */
+    long long call_cnt;                 /* Number of calls. */
+    long long cycles;                   /* Cycles spent in FUNC. */
+  };
+
+static syscall_func sc_halt, sc_exit, sc_exec, sc_wait, sc_spawn, sc_create,
+  sc_remove, sc_open, sc_filesize, sc_read, sc_write, sc_seek, sc_tell,
+  sc_close, sc_copy_file_range, sc_fibonacci, sc_max_of_four_int,
+  sc_blockstat, sc_readv, sc_writev, sc_pread, sc_pwrite;
+#ifdef VM
+static syscall_func sc_mmap, sc_munmap, sc_vmstat;
+#endif
+#ifdef FILESYS
+static syscall_func sc_chdir, sc_mkdir, sc_readdir, sc_isdir, sc_inumber;
+#endif
+
+/* System calls, indexed by number.  Calls not built into this
+   kernel have a null FUNC. */
+static struct syscall syscalls[] =
+  {
+    [SYS_HALT] = {"halt", sc_halt, 0, {}, 0},
+    [SYS_EXIT] = {"exit", sc_exit, 1, {ARG_VALUE}, 0},
+    [SYS_EXEC] = {"exec", sc_exec, 1, {ARG_STRING}, PID_ERROR},
+    [SYS_WAIT] = {"wait", sc_wait, 1, {ARG_VALUE}, 0},
+    [SYS_CREATE] = {"create", sc_create, 2, {ARG_STRING, ARG_VALUE}, false},
+    [SYS_REMOVE] = {"remove", sc_remove, 1, {ARG_STRING}, false},
+    [SYS_OPEN] = {"open", sc_open, 1, {ARG_STRING}, -1},
+    [SYS_FILESIZE] = {"filesize", sc_filesize, 1, {ARG_VALUE}, 0},
+    [SYS_READ] = {"read", sc_read, 3,
+                  {ARG_VALUE, ARG_USER_PTR, ARG_VALUE}, 0},
+    [SYS_WRITE] = {"write", sc_write, 3,
+                   {ARG_VALUE, ARG_USER_PTR, ARG_VALUE}, 0},
+    [SYS_SEEK] = {"seek", sc_seek, 2, {ARG_VALUE, ARG_VALUE}, 0},
+    [SYS_TELL] = {"tell", sc_tell, 1, {ARG_VALUE}, 0},
+    [SYS_CLOSE] = {"close", sc_close, 1, {ARG_VALUE}, 0},
+#ifdef VM
+    [SYS_MMAP] = {"mmap", sc_mmap, 2, {ARG_VALUE, ARG_VALUE}, 0},
+    [SYS_MUNMAP] = {"munmap", sc_munmap, 1, {ARG_VALUE}, 0},
+#endif
+#ifdef FILESYS
+    [SYS_CHDIR] = {"chdir", sc_chdir, 1, {ARG_STRING}, false},
+    [SYS_MKDIR] = {"mkdir", sc_mkdir, 1, {ARG_STRING}, false},
+    [SYS_READDIR] = {"readdir", sc_readdir, 2,
+                     {ARG_VALUE, ARG_USER_PTR}, 0},
+    [SYS_ISDIR] = {"isdir", sc_isdir, 1, {ARG_VALUE}, 0},
+    [SYS_INUMBER] = {"inumber", sc_inumber, 1, {ARG_VALUE}, 0},
+#endif
+    [SYS_FIBO] = {"fibonacci", sc_fibonacci, 1, {ARG_VALUE}, 0},
+    [SYS_MAXFOUR] = {"max_of_four_int", sc_max_of_four_int, 4,
+                     {ARG_VALUE, ARG_VALUE, ARG_VALUE, ARG_VALUE}, 0},
+#ifdef VM
+    [SYS_VMSTAT] = {"vmstat", sc_vmstat, 2,
+                    {ARG_USER_PTR, ARG_USER_PTR}, 0},
 #endif
+    [SYS_BLOCKSTAT] = {"blockstat", sc_blockstat, 2,
+                       {ARG_VALUE, ARG_USER_PTR}, 0},
+    [SYS_COPY_FILE_RANGE] = {"copy_file_range", sc_copy_file_range, 3,
+                             {ARG_VALUE, ARG_VALUE, ARG_VALUE}, 0},
+    [SYS_READV] = {"readv", sc_readv, 3,
+                   {ARG_VALUE, ARG_USER_PTR, ARG_VALUE}, 0},
+    [SYS_WRITEV] = {"writev", sc_writev, 3,
+                    {ARG_VALUE, ARG_USER_PTR, ARG_VALUE}, 0},
+    [SYS_PREAD] = {"pread", sc_pread, 4,
+                   {ARG_VALUE, ARG_USER_PTR, ARG_VALUE, ARG_VALUE}, 0},
+    [SYS_PWRITE] = {"pwrite", sc_pwrite, 4,
+                    {ARG_VALUE, ARG_USER_PTR, ARG_VALUE, ARG_VALUE}, 0},
+    [SYS_SPAWN] = {"spawn", sc_spawn, 3,
+                   {ARG_USER_PTR, ARG_USER_PTR, ARG_VALUE}, 0},
+  };
+
 static void
 syscall_handler (struct intr_frame *f) 
 {
-  int syscall_number;
-  read_user(f->esp,&syscall_number,sizeof(syscall_number));
+  uint32_t syscall_number;
+  uint32_t args[SYSCALL_ARGS_MAX];
+  struct syscall *sc;
+  uint64_t start;
+  enum intr_level old_level;
+  int i;
+
   thread_current()->current_esp = f->esp;
-  
-  switch(*(uint32_t *)(f->esp)){
-   case SYS_HALT:                   /* Halt the operating system. */
-      sys_halt();
-    break;
-
-  case SYS_EXIT:                   /* Terminate this process. */
-      // void exit (int status)
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
+  if(!copy_from_user(&syscall_number, f->esp, sizeof syscall_number))
+    fail_invalid_access();
+  if(syscall_number >= sizeof syscalls / sizeof *syscalls
+     || syscalls[syscall_number].func == NULL)
+    sys_exit(-1);
+  sc = &syscalls[syscall_number];
+  if(!copy_from_user(args, (uint32_t *) f->esp + 1, sc->argc * sizeof *args))
+    fail_invalid_access();
+
+  /* Check pointers before copying in strings, so that a bad
+     pointer cannot leak a string's page. */
+  for(i = 0; i < sc->argc; i++)
+    if(sc->args[i] == ARG_USER_PTR && !is_user_vaddr((void *) args[i]))
+      sys_exit(-1);
+  for(i = 0; i < sc->argc; i++)
+    if(sc->args[i] == ARG_STRING){
+      args[i] = (uint32_t) copy_in_string((const char *) args[i]);
+      if(args[i] == 0){
+        f->eax = sc->error;
+        return;
       }
-      sys_exit(*(int32_t *)(f->esp + 4));
-    break;
-
-    case SYS_EXEC: //2
-    {
-      void *cmd;
-      read_user(f->esp+4,&cmd,sizeof(cmd));
-      int ret_value = sys_exec((const char*)cmd);
-      f->eax = (uint32_t) ret_value;
-      break;
     }
 
-    case SYS_WAIT:                   /* Wait for a child process to die. */
-      // int wait(pit_d pid);
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      f->eax=sys_wait(*(pid_t*)(f->esp + 4));
-    break;
-  
-    case SYS_CREATE:                 /* Create a file. */
-    // bool create(const char *file, unsigned initial_size);
-      if(!is_user_vaddr(f->esp+4)||!is_user_vaddr(f->esp+8)){
-        sys_exit(-1);
-      }
-      f->eax=sys_create(*(const char**)(f->esp+4),*(unsigned*)(f->esp+8));
-    break;
+  old_level = intr_disable();
+  sc->call_cnt++;
+  intr_set_level(old_level);
 
-    case SYS_REMOVE:                 /* Delete a file. */
-    // bool remove (const char *file);
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      f->eax=sys_remove(*(const char**)(f->esp+4));
-    break;
+  start = timer_cycles();
+  f->eax = sc->func(args);
 
-    case SYS_OPEN:                   /* Open a file. */
-    // int open (const char *file);
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      f->eax=sys_open(*(const char**)(f->esp+4));
-    break;
+  old_level = intr_disable();
+  sc->cycles += timer_cycles() - start;
+  intr_set_level(old_level);
 
-    case SYS_FILESIZE:               /* Obtain a file's size. */
-    // int filesize (int fd);
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      f->eax=sys_filesize(*(int*)(f->esp+4));
-    break;
+  for(i = 0; i < sc->argc; i++)
+    if(sc->args[i] == ARG_STRING)
+      palloc_free_page((void *) args[i]);
+}
 
-    case SYS_READ:                   /* Read from a file. */
-    // int read(int fd, void *buffer, unsigned size);
-      if(!is_user_vaddr(f->esp+4)||!is_user_vaddr(f->esp+8)||!is_user_vaddr(f->esp+12)){
-        sys_exit(-1);
-      }
-      f->eax=sys_read(*(int *)(f->esp + 4), (void *)*(uint32_t *)(f->esp +8), *(unsigned *)(f->esp+12));
-    break;
+/* Prints the number of calls to each system call and the mean
+   number of cycles each took.  exit never returns, so its cycles
+   are not counted. */
+void syscall_print_stats(void)
+{
+  size_t i;
 
-    case SYS_WRITE:                  /* Write to a file. */
-    // int write (int fd, const void *buffer, unsigned size);
-      if(!is_user_vaddr(f->esp+4)||!is_user_vaddr(f->esp+8)||!is_user_vaddr(f->esp+12)){
-          sys_exit(-1);
-      }
-      f->eax=sys_write(*(int *)(f->esp + 4), (void *)*(uint32_t *)(f->esp +8), *(unsigned *)(f->esp+12));
-    break;
+  printf("System calls:\n");
+  for(i = 0; i < sizeof syscalls / sizeof *syscalls; i++){
+    struct syscall *sc = &syscalls[i];
+    if(sc->call_cnt == 0)
+      continue;
+    printf("  %s: %lld calls", sc->name, sc->call_cnt);
+    if(i != SYS_EXIT && i != SYS_HALT)
+      printf(", %lld cycles each", sc->cycles / sc->call_cnt);
+    printf("\n");
+  }
+}
 
-    case SYS_SEEK:                   /* Change position in a file. */
-    // void seek(int fd,unsigned position);
-      if(!is_user_vaddr(f->esp+4)||!is_user_vaddr(f->esp+8)){
-        sys_exit(-1);
-      }
-      sys_seek(*(int*)(f->esp+4),*(unsigned*)(f->esp+8));
-    break;
+static uint32_t sc_halt(const uint32_t args[] UNUSED){
+  sys_halt();
+  NOT_REACHED();
+}
 
-    case SYS_TELL:                   /* Report current position in a file. */
-    // unsigned tell(int fd);
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      f->eax=sys_tell(*(int*)(f->esp+4));
-    break;
+static uint32_t sc_exit(const uint32_t args[]){
+  sys_exit((int) args[0]);
+  NOT_REACHED();
+}
 
-    case SYS_CLOSE:                 
-    // void close(int fd);
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      sys_close(*(int*)(f->esp+4));
-    break;
-    case SYS_FIBO:
-      if(!is_user_vaddr(f->esp+4)){
-        sys_exit(-1);
-      }
-      f->eax=fibonacci(*(int *)(f->esp + 4));
-    break;
-    case SYS_MAXFOUR:
-      if(!is_user_vaddr(f->esp+4)||!is_user_vaddr(f->esp+8)||!is_user_vaddr(f->esp+12)||!is_user_vaddr(f->esp+16)){
-          sys_exit(-1);
-      }
-      f->eax=max_of_four_int(*(int *)(f->esp +4),*(int *)(f->esp +8),*(int *)(f->esp +12),*(int *)(f->esp +16));
-    break;
-#ifdef VM
-    case SYS_MMAP:
-    {
-      if(!is_user_vaddr(f->esp+4)||!is_user_vaddr(f->esp+8)){
-        sys_exit(-1);
-      }
-      mmapid_t ret_val = sys_mmap (*(int *)(f->esp+4), (void *)*(uint32_t *)(f->esp+8));
-      f->eax = ret_val;
-      break;
-    }
+static uint32_t sc_exec(const uint32_t args[]){
+  return sys_exec((const char *) args[0]);
+}
 
-  case SYS_MUNMAP:
-    if(!is_user_vaddr(f->esp+4)){
-      sys_exit(-1);
-    }
-    sys_munmap(*(mmapid_t *)(f->esp+4));
-    break;
-#endif
-#ifdef FILESYS
-  case SYS_CHDIR: // 15
-    {
-      const char* filename;
-      int return_code;
+static uint32_t sc_wait(const uint32_t args[]){
+  return sys_wait((pid_t) args[0]);
+}
 
-      memread_user(f->esp + 4, &filename, sizeof(filename));
+static uint32_t sc_spawn(const uint32_t args[]){
+  return sys_spawn((const char **) args[0], (const struct spawn_fd *) args[1],
+                   (int) args[2]);
+}
 
-      return_code = sys_chdir(filename);
-      f->eax = return_code;
-      break;
-    }
+static uint32_t sc_create(const uint32_t args[]){
+  return sys_create((const char *) args[0], (unsigned) args[1]);
+}
 
-  case SYS_MKDIR: // 16
-    {
-      const char* filename;
-      int return_code;
+static uint32_t sc_remove(const uint32_t args[]){
+  return sys_remove((const char *) args[0]);
+}
 
-      memread_user(f->esp + 4, &filename, sizeof(filename));
+static uint32_t sc_open(const uint32_t args[]){
+  return sys_open((const char *) args[0]);
+}
 
-      return_code = sys_mkdir(filename);
-      f->eax = return_code;
-      break;
-    }
+static uint32_t sc_filesize(const uint32_t args[]){
+  return sys_filesize((int) args[0]);
+}
 
-  case SYS_READDIR: // 17
-    {
-      int fd;
-      char *name;
-      int return_code;
+static uint32_t sc_read(const uint32_t args[]){
+  return sys_read((int) args[0], (void *) args[1], (unsigned) args[2]);
+}
 
-      memread_user(f->esp + 4, &fd, sizeof(fd));
-      memread_user(f->esp + 8, &name, sizeof(name));
+static uint32_t sc_write(const uint32_t args[]){
+  return sys_write((int) args[0], (const void *) args[1], (unsigned) args[2]);
+}
 
-      return_code = sys_readdir(fd, name);
-      f->eax = return_code;
-      break;
-    }
+static uint32_t sc_seek(const uint32_t args[]){
+  sys_seek((int) args[0], (unsigned) args[1]);
+  return 0;
+}
 
-  case SYS_ISDIR: // 18
-    {
-      int fd;
-      int return_code;
+static uint32_t sc_tell(const uint32_t args[]){
+  return sys_tell((int) args[0]);
+}
 
-      memread_user(f->esp + 4, &fd, sizeof(fd));
-      return_code = sys_isdir(fd);
-      f->eax = return_code;
-      break;
-    }
+static uint32_t sc_close(const uint32_t args[]){
+  sys_close((int) args[0]);
+  return 0;
+}
 
-  case SYS_INUMBER: // 19
-    {
-      int fd;
-      int return_code;
+static uint32_t sc_copy_file_range(const uint32_t args[]){
+  return sys_copy_file_range((int) args[0], (int) args[1], (unsigned) args[2]);
+}
 
-      memread_user(f->esp + 4, &fd, sizeof(fd));
-      return_code = sys_inumber(fd);
-      f->eax = return_code;
-      break;
-    }
+static uint32_t sc_fibonacci(const uint32_t args[]){
+  return fibonacci((int) args[0]);
+}
+
+static uint32_t sc_max_of_four_int(const uint32_t args[]){
+  return max_of_four_int((int) args[0], (int) args[1], (int) args[2],
+                         (int) args[3]);
+}
+
+#ifdef VM
+static uint32_t sc_mmap(const uint32_t args[]){
+  return sys_mmap((int) args[0], (void *) args[1]);
+}
+
+static uint32_t sc_munmap(const uint32_t args[]){
+  sys_munmap((mmapid_t) args[0]);
+  return 0;
+}
 
+static uint32_t sc_vmstat(const uint32_t args[]){
+  sys_vmstat((struct vm_stat *) args[0], (struct vm_stat *) args[1]);
+  return 0;
+}
 #endif
-  }
+
+#ifdef FILESYS
+static uint32_t sc_chdir(const uint32_t args[]){
+  return sys_chdir((const char *) args[0]);
+}
+
+static uint32_t sc_mkdir(const uint32_t args[]){
+  return sys_mkdir((const char *) args[0]);
+}
+
+static uint32_t sc_readdir(const uint32_t args[]){
+  return sys_readdir((int) args[0], (char *) args[1]);
+}
+
+static uint32_t sc_isdir(const uint32_t args[]){
+  return sys_isdir((int) args[0]);
+}
+
+static uint32_t sc_inumber(const uint32_t args[]){
+  return sys_inumber((int) args[0]);
+}
+#endif
+
+static uint32_t sc_blockstat(const uint32_t args[]){
+  return sys_blockstat((int) args[0], (struct block_stat *) args[1]);
+}
+
+static uint32_t sc_readv(const uint32_t args[]){
+  return sys_readv((int) args[0], (const struct iovec *) args[1],
+                   (int) args[2]);
+}
+
+static uint32_t sc_writev(const uint32_t args[]){
+  return sys_writev((int) args[0], (const struct iovec *) args[1],
+                    (int) args[2]);
+}
+
+static uint32_t sc_pread(const uint32_t args[]){
+  return sys_pread((int) args[0], (void *) args[1], (unsigned) args[2],
+                   (unsigned) args[3]);
+}
+
+static uint32_t sc_pwrite(const uint32_t args[]){
+  return sys_pwrite((int) args[0], (const void *) args[1],
+                    (unsigned) args[2], (unsigned) args[3]);
 }
 
 
@@ -601,9 +939,27 @@ syscall_handler (struct intr_frame *f)
 /************Memory Check******/
 
 
-void check_user(const uint8_t *addr){
-  if(get_user(addr) == -1){
+/* Kills the process unless the SIZE bytes at user address BUFFER
+   are valid user memory that is also writable if WRITABLE.  Probes
+   every page of the buffer, not just its first and last bytes.
+   Call it before taking file_system_lock, so that a bad buffer
+   kills the process without the lock held.  The probe only
+   validates the buffer: with VM, a page can still be evicted
+   before it is used, and only preload_and_pin_pages() keeps the
+   file system from faulting on it. */
+static void check_user_buffer(const void *buffer, size_t size, bool writable){
+  const uint8_t *p = buffer;
+  const uint8_t *end = p + size;
+
+  if(size == 0)
+    return;
+  if(!is_user_range(buffer, size))
     is_invalid();
+  while(p < end){
+    int byte = get_user(p);
+    if(byte == -1 || (writable && !put_user((uint8_t *) p, byte)))
+      is_invalid();
+    p = (const uint8_t *) pg_round_down(p) + PGSIZE;
   }
 }
 
@@ -617,37 +973,187 @@ static int get_user(const uint8_t *addr){
   return result;
 }
 
-static int read_user(void *src, void *dst, size_t bytes){
-  int32_t value;
-  size_t i;
-  for(i=0;i < bytes;i++){
-    value = get_user(src + i);
-    if(value == -1)
-      is_invalid();
-    
-    *(char*)(dst + i) = value & 0xff;
-  }
-  return (int)bytes;
+/* Writes BYTE to user address UDST, which must be below
+   PHYS_BASE.  Returns true if successful, false if a page fault
+   occurred. */
+static bool put_user(uint8_t *udst, uint8_t byte){
+  int error_code;
+  asm("movl $1f, %0; movb %b2, %1; 1:"
+      : "=&a"(error_code), "=m"(*udst) : "q"(byte));
+  return error_code != -1;
 }
 
-static struct fd_struct* find_file_desc(struct thread *t,int fd,enum search_type flag){
-  ASSERT(t!=NULL);
-  if(fd < 3){
+/* Returns true if the SIZE bytes starting at UADDR all lie in
+   user virtual address space. */
+static bool is_user_range(const void *uaddr, size_t size){
+  return is_user_vaddr(uaddr) && size <= (size_t) (PHYS_BASE - uaddr);
+}
+
+/* Copies SIZE bytes between DST and SRC, one of which is in user
+   space and has been range-checked, a word at a time and then a
+   byte at a time.  Returns false if a page fault could not be
+   resolved partway through.
+
+   Like get_user(), this relies on page_fault() resuming a
+   faulting kernel access at the address in EAX with EAX set to
+   -1, but it arms that recovery once for the whole copy rather
+   than once per byte. */
+static bool copy_user(void *dst, const void *src, size_t size){
+  int result;
+  size_t words = size / sizeof (uint32_t);
+  asm volatile ("movl $1f, %%eax\n\t"
+                "rep movsl\n\t"
+                "movl %4, %%ecx\n\t"
+                "rep movsb\n"
+                "1:"
+                : "=&a"(result), "+S"(src), "+D"(dst), "+c"(words)
+                : "rm"(size % sizeof (uint32_t))
+                : "memory");
+  return result != -1;
+}
+
+/* Copies SIZE bytes from user address USRC to DST.  Returns true
+   if successful, false if USRC is not valid user memory. */
+static bool copy_from_user(void *dst, const void *usrc, size_t size){
+  if(size == 0)
+    return true;
+  return is_user_range(usrc, size) && copy_user(dst, usrc, size);
+}
+
+/* Copies SIZE bytes from SRC to user address UDST.  Returns true
+   if successful, false if UDST is not valid, writable user
+   memory. */
+static bool copy_to_user(void *udst, const void *src, size_t size){
+  if(size == 0)
+    return true;
+  return is_user_range(udst, size) && copy_user(udst, src, size);
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes including the null
+   terminator.  Returns the length of the string, SIZE if it does
+   not fit (DST is then not null-terminated), or -1 if USRC is
+   not valid user memory. */
+static int strncpy_from_user(char *dst, const char *usrc, size_t size){
+  const char *src = usrc;
+  size_t cnt = size;
+  bool hits_kernel;
+  int result;
+
+  if(size == 0 || !is_user_vaddr(usrc))
+    return -1;
+  /* Stop at the top of user space: a string that runs into it is
+     invalid rather than too long. */
+  hits_kernel = !is_user_range(usrc, size);
+  if(hits_kernel)
+    cnt = (size_t) ((const char *) PHYS_BASE - usrc);
+
+  asm volatile ("movl $2f, %%eax\n"
+                "1:\t"
+                "movb (%%esi), %%dl\n\t"
+                "movb %%dl, (%%edi)\n\t"
+                "incl %%esi\n\t"
+                "incl %%edi\n\t"
+                "testb %%dl, %%dl\n\t"
+                "jz 2f\n\t"
+                "decl %%ecx\n\t"
+                "jnz 1b\n"
+                "2:"
+                : "=&a"(result), "+S"(src), "+D"(dst), "+c"(cnt)
+                :
+                : "edx", "cc", "memory");
+  if(result == -1)
+    return -1;
+  if(cnt == 0)
+    return hits_kernel ? -1 : (int) size;
+  return src - usrc - 1;
+}
+
+/* Copies the string at user address USTR into a new page and
+   returns it, or returns a null pointer if the string does not
+   fit in a page or no page is available.  Kills the process if
+   USTR is not valid.  The caller must free the page with
+   palloc_free_page(). */
+static char *copy_in_string(const char *ustr){
+  char *kstr = palloc_get_page(0);
+  int len;
+
+  if(kstr == NULL)
+    return NULL;
+  len = strncpy_from_user(kstr, ustr, PGSIZE);
+  if(len < 0){
+    palloc_free_page(kstr);
+    fail_invalid_access();
+  }
+  if(len == PGSIZE){
+    palloc_free_page(kstr);
     return NULL;
   }
+  return kstr;
+}
 
-  struct list_elem *e;
-  if(!list_empty(&t->file_descriptors)){
-    for(e = list_begin(&t->file_descriptors);e !=list_end(&t->file_descriptors);e = list_next(e)){
-      struct fd_struct *desc = list_entry(e, struct fd_struct, elem);
-      if(desc -> id == fd){
-        if (desc->dir!=NULL&& (flag & FD_DIRECTORY) )
-          return desc;
-        else if(desc->dir == NULL && (flag & FD_FILE) )
-          return desc;
-      }
+/* Copies the null-terminated array of strings at user address
+   UARGV into a new page, each string null-terminated and directly
+   after the one before, stores their number in *ARGC, and returns
+   the page.  Returns a null pointer if UARGV is empty, the strings
+   and the argv array built from them would not fit in the child's
+   first stack page, or no page is available.  Kills the process
+   if UARGV or any of its strings is not valid.  The caller must
+   free the page with palloc_free_page(). */
+static char *copy_in_argv(const char **uargv, int *argc){
+  char *kstr = palloc_get_page(0);
+  size_t ofs = 0;
+  int i;
+
+  if(kstr == NULL)
+    return NULL;
+  for(i = 0; ; i++){
+    const char *uarg;
+    int len;
+
+    if(!copy_from_user(&uarg, uargv + i, sizeof uarg)){
+      palloc_free_page(kstr);
+      fail_invalid_access();
+    }
+    if(uarg == NULL)
+      break;
+    if(ofs == PGSIZE){
+      palloc_free_page(kstr);
+      return NULL;
+    }
+    len = strncpy_from_user(kstr + ofs, uarg, PGSIZE - ofs);
+    if(len < 0){
+      palloc_free_page(kstr);
+      fail_invalid_access();
+    }
+    if((size_t) len == PGSIZE - ofs){
+      palloc_free_page(kstr);
+      return NULL;
     }
+    ofs += len + 1;
   }
+
+  /* Besides the strings, push_userstack() needs up to 3 bytes of
+     padding, argv[0] through argv[argc], argv, argc and a return
+     address. */
+  if(i == 0 || ofs + WORD_SIZE - 1 + (i + 4) * WORD_SIZE > PGSIZE){
+    palloc_free_page(kstr);
+    return NULL;
+  }
+  *argc = i;
+  return kstr;
+}
+
+static struct fd_struct* find_file_desc(struct thread *t,int fd,enum search_type flag){
+  ASSERT(t!=NULL);
+
+  struct fd_struct *desc = fd_table_get(&t->fd_table, fd);
+  if(desc == NULL)
+    return NULL;
+  if (desc->dir!=NULL&& (flag & FD_DIRECTORY) )
+    return desc;
+  else if(desc->dir == NULL && (flag & FD_FILE) )
+    return desc;
   return NULL;
 }
 
@@ -683,7 +1189,6 @@ static struct mmap_desc* find_mmap_desc(struct thread *t, mmapid_t mid)
 bool sys_chdir(const char *filename)
 {
   bool return_code;
-  check_user((const uint8_t*) filename);
 
   lock_acquire (&file_system_lock);
   return_code = filesys_chdir(filename);
@@ -695,7 +1200,6 @@ bool sys_chdir(const char *filename)
 bool sys_mkdir(const char *filename)
 {
   bool return_code;
-  check_user((const uint8_t*) filename);
 
   lock_acquire (&file_system_lock);
   return_code = filesys_create(filename, 0, true);
@@ -703,9 +1207,13 @@ bool sys_mkdir(const char *filename)
 
   return return_code;
 }
+/* Reads the next entry into a kernel buffer, and copies it out to
+   NAME only after releasing file_system_lock, so that a bad NAME
+   cannot fault with the lock held. */
 bool sys_readdir(int fd, char *name)
 {
   struct fd_struct* file_desc;
+  char kname[NAME_MAX + 1];
   bool ret = false;
 
   lock_acquire (&file_system_lock);
@@ -720,10 +1228,12 @@ bool sys_readdir(int fd, char *name)
   if(! inode_is_directory(inode)) goto done;
 
   ASSERT (file_desc->dir != NULL); // see sys_open()
-  ret = dir_readdir (file_desc->dir, name);
+  ret = dir_readdir (file_desc->dir, kname);
 
 done:
   lock_release (&file_system_lock);
+  if (ret && !copy_to_user (name, kname, strlen (kname) + 1))
+    fail_invalid_access ();
   return ret;
 }
 
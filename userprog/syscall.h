@@ -1,13 +1,21 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 #include "userprog/process.h"
+#include <blockstat.h>
+#include <iovec.h>
+#include "threads/synch.h"
+
+/* Serializes all file system access by user processes. */
+extern struct lock file_system_lock;
 
 void syscall_init (void);
+void syscall_print_stats (void);
 
 void sys_halt(void);
 void sys_exit(int status);
 pid_t sys_exec(const char *cmd_line);
 int sys_wait(pid_t pid);
+pid_t sys_spawn(const char **argv, const struct spawn_fd *fds, int fd_cnt);
 
 bool sys_create(const char *file_name, unsigned initial_size);
 bool sys_remove(const char *file_name);
@@ -19,14 +27,21 @@ int sys_write(int fd, const void *buffer,unsigned size);
 void sys_seek(int fd, unsigned position);
 unsigned sys_tell(int fd);
 void sys_close(int fd);
+int sys_copy_file_range(int in_fd, int out_fd, unsigned size);
+int sys_readv(int fd, const struct iovec *iov, int iovcnt);
+int sys_writev(int fd, const struct iovec *iov, int iovcnt);
+int sys_pread(int fd, void *buffer, unsigned size, unsigned offset);
+int sys_pwrite(int fd, const void *buffer, unsigned size, unsigned offset);
 
 int fibonacci(int n);
 int max_of_four_int(int a,int b, int c, int d);
+bool sys_blockstat(int role, struct block_stat *stat);
 
 
 #ifdef VM
 void sys_munmap(mmapid_t);
 mmapid_t sys_mmap(int fd, void *);
+void sys_vmstat(struct vm_stat *proc, struct vm_stat *global);
 #endif
 
 
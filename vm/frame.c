@@ -5,9 +5,11 @@
 #include "lib/kernel/list.h"
 
 #include "vm/frame.h"
+#include "vm/stat.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "userprog/pagedir.h"
 #include "threads/vaddr.h"
 
@@ -18,6 +20,7 @@ static struct list_elem *victim_ptr;
 
 static struct lock frame_lock;
 static struct hash frame_map;
+static struct slab_cache fte_cache;
 
 
 
@@ -40,6 +43,7 @@ void vm_frame_init (){
   lock_init (&frame_lock);
   hash_init (&frame_map, frame_hash_func, frame_less_func, NULL);
   list_init (&frame_list);
+  slab_cache_init (&fte_cache, "frame", sizeof (struct frame_table_entry), NULL);
   victim_ptr = NULL;
 }
 static unsigned frame_hash_func(const struct hash_elem *elem, void *aux UNUSED){
@@ -73,7 +77,7 @@ vm_frame_allocate (enum palloc_flags flags, void *upage)
     vm_frame_del_entry_freepage(evic_entry->kpage); 
     frame_page = palloc_get_page (PAL_USER | flags);
   }
-  struct frame_table_entry *fte = malloc(sizeof(struct frame_table_entry));
+  struct frame_table_entry *fte = slab_alloc(&fte_cache);
   if(fte != NULL) {
     fte->upage = upage;
     fte->pinned = true;
@@ -111,7 +115,7 @@ void vm_frame_del_entry_freepage (void *kpage){
     hash_delete (&frame_map, &fte->helem);
     list_remove (&fte->lelem);
     palloc_free_page(kpage);
-    free(fte);
+    slab_free(&fte_cache, fte);
   }else{
     sys_exit(-1);
   }
@@ -124,7 +128,7 @@ void vm_frame_del_entry_notfreepage (void *kpage){
     struct frame_table_entry *fte= hash_entry(find_e, struct frame_table_entry, helem);
     hash_delete (&frame_map, &fte->helem);
     list_remove (&fte->lelem);
-    free(fte);
+    slab_free(&fte_cache, fte);
   }
   else{
     sys_exit(-1);
@@ -150,15 +154,19 @@ struct frame_table_entry* clock_algorithm( uint32_t *pagedir ) {
   if(n<=0){
     sys_exit(-1);
   }
+  size_t pin_skip = 0;
   for(size_t it = 0; it <= 2*n; ++ it) // prevent infinite loop. 
   {
     struct frame_table_entry *e = clock_pointing_frame();
-    if(e->pinned)
+    if(e->pinned){
+      pin_skip++;
       continue;
+    }
     else if( pagedir_is_accessed(pagedir, e->upage)) {
       pagedir_set_accessed(pagedir, e->upage, false);
       continue;
     }
+    vm_stat_count_eviction(e->t, it + 1, pin_skip);
     return e;
   }
 }
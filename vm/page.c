@@ -4,19 +4,29 @@
 #include "lib/kernel/hash.h"
 #include "page.h"
 #include "frame.h"
+#include "stat.h"
 #include "filesys/file.h"
 #include "threads/synch.h"
 #include "threads/malloc.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "userprog/elfcache.h"
 
 static unsigned pte_hash_func(const struct hash_elem *elem, void *aux);
 static bool pte_less_func(const struct hash_elem *, const struct hash_elem *, void *aux);
 static void pte_destroy_func(struct hash_elem *elem, void *aux);
 static bool vm_load_page_from_filesys(struct vm_pt_entry *, void *);
 
+//page table entry를 할당하는 slab cache
+static struct slab_cache pte_cache;
+
+void vm_page_init(void){
+    slab_cache_init(&pte_cache, "pte", sizeof(struct vm_pt_entry), NULL);
+}
+
 //vm_page_hashtable 을 생성하는 함수
 struct vm_page_table *vm_pt_create(void){
     struct vm_page_table *pt = 
@@ -83,7 +93,7 @@ static void pte_destroy_func(struct hash_elem *elem, void *aux UNUSED){
         vm_swap_free(pt_entry->swap_index); // swap free
     }
     if(pt_entry!=NULL){
-        free(pt_entry); //pte free
+        slab_free(&pte_cache, pt_entry); //pte free
     }
 }
 static bool vm_load_page_from_filesys(struct vm_pt_entry *pte, void *kpage){
@@ -121,7 +131,7 @@ page table entry를 생성해 초기화하고
 page_hash_table에 insert한다.*/
 bool vm_pt_install_frame(struct vm_page_table *pt, void *upage, void *kpage){
     struct vm_pt_entry *page_hash_table_entry;
-    page_hash_table_entry = (struct vm_pt_entry *) malloc(sizeof(struct vm_pt_entry));
+    page_hash_table_entry = slab_alloc(&pte_cache);
 
     if(page_hash_table_entry==NULL){
         sys_exit(-1);
@@ -137,7 +147,7 @@ bool vm_pt_install_frame(struct vm_page_table *pt, void *upage, void *kpage){
     struct hash_elem *prev = hash_insert(page_hash_table, pt_entry_elem);
     if(prev != NULL){
         if(page_hash_table_entry!=NULL)
-            free(page_hash_table_entry);
+            slab_free(&pte_cache, page_hash_table_entry);
         return false;
     }
     return true;
@@ -160,7 +170,7 @@ page table entry를 생성해 초기화하고 (status 가 ALL_ZERO)
 page_hash_table에 insert한다.*/
 bool expand_stack (struct vm_page_table *pt, void *upage){
     struct vm_pt_entry *page_hash_table_entry;
-    page_hash_table_entry = (struct vm_pt_entry *) malloc(sizeof(struct vm_pt_entry));
+    page_hash_table_entry = slab_alloc(&pte_cache);
     if(page_hash_table_entry==NULL){
         sys_exit(-1);
     }
@@ -173,7 +183,7 @@ bool expand_stack (struct vm_page_table *pt, void *upage){
     struct hash_elem* pt_entry_elem=&page_hash_table_entry->elem;
     struct hash_elem *prev = hash_insert(page_hash_table, pt_entry_elem);
     if(prev != NULL){
-        free(page_hash_table_entry);
+        slab_free(&pte_cache, page_hash_table_entry);
         sys_exit(-1);
         return false;
     }
@@ -185,7 +195,7 @@ page_hash_table에 insert한다.*/
 bool vm_pt_install_filesys(struct vm_page_table *pt, void *upage,
     struct file *file, off_t offset, uint32_t read_bytes, uint32_t zero_bytes,bool writable){
     struct vm_pt_entry *page_hash_table_entry;
-    page_hash_table_entry = (struct vm_pt_entry *) malloc(sizeof(struct vm_pt_entry));
+    page_hash_table_entry = slab_alloc(&pte_cache);
     if(page_hash_table_entry==NULL){
         sys_exit(-1);
     }
@@ -203,7 +213,7 @@ bool vm_pt_install_filesys(struct vm_page_table *pt, void *upage,
     struct hash_elem* pt_entry_elem=&page_hash_table_entry->elem;
     struct hash_elem *prev = hash_insert(page_hash_table, pt_entry_elem);
     if(prev != NULL){
-        free(page_hash_table_entry);
+        slab_free(&pte_cache, page_hash_table_entry);
         sys_exit(-1);
         return false;
     }
@@ -236,8 +246,9 @@ bool handle_mm_fault(struct vm_page_table *pt, uint32_t *pagedir, void *upage){
     //이미 로드 되었을때
     if(pte->status == ON_FRAME)
         return true;
-    //frame을 allocate 한다.
-    void *frame_page = vm_frame_allocate(PAL_USER, upage);
+    //frame을 allocate 한다. ALL_ZERO 이면 미리 0으로 채워진 page를 받는다.
+    void *frame_page = vm_frame_allocate(
+        pte->status == ALL_ZERO ? PAL_USER | PAL_ZERO : PAL_USER, upage);
     if(frame_page == NULL){
         return false;
     }
@@ -247,8 +258,7 @@ bool handle_mm_fault(struct vm_page_table *pt, uint32_t *pagedir, void *upage){
         case ON_SWAP:// swap space 에 있는 경우
             vm_swap_in(pte->swap_index, frame_page);// 디스크에서 메모리로 load
             break;
-        case ALL_ZERO:
-            memset(frame_page, 0 , PGSIZE);
+        case ALL_ZERO: // PAL_ZERO 로 이미 0으로 채워져 있다.
             break;
         case FROM_FILESYS: // 디스크에서 메모리로 load하는 경우
             if(vm_load_page_from_filesys(pte, frame_page)){
@@ -262,6 +272,7 @@ bool handle_mm_fault(struct vm_page_table *pt, uint32_t *pagedir, void *upage){
         case ON_FRAME:
             break;
     }
+    vm_stat_count_fault(pte->status);
     //
     if(!pagedir_set_page(pagedir, upage, frame_page, writable)){
         vm_frame_free(frame_page);
@@ -294,6 +305,7 @@ bool vm_pt_mm_unmap(struct vm_page_table *pt, uint32_t *pagedir, void *page,
         is_dirty = is_dirty || u_is_dirty||k_is_dirty;
         if(is_dirty){
             file_write_at(file, pt_entry->upage, bytes, offset);
+            elfcache_invalidate(file_get_inode(file));
         }
         //page mapping을 지우고 free
         vm_frame_free(pt_entry->kpage);
@@ -308,6 +320,7 @@ bool vm_pt_mm_unmap(struct vm_page_table *pt, uint32_t *pagedir, void *page,
             void *tmp_page = palloc_get_page(0);
             vm_swap_in(pt_entry->swap_index, tmp_page);
             file_write_at(file,tmp_page,PGSIZE,offset);
+            elfcache_invalidate(file_get_inode(file));
             palloc_free_page(tmp_page);
         }
         else {
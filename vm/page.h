@@ -53,6 +53,7 @@ void unpin_preloaded_pages(const void *, size_t);
 void vm_pin_page(struct vm_page_table *pt, void *page);
 void vm_unpin_page(struct vm_page_table *pt, void *page);
 
+void vm_page_init(void);
 struct vm_page_table *vm_pt_create(void);
 void vm_page_table_destroy(struct vm_page_table *pt);
 
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "vm/stat.h"
+#include "threads/interrupt.h"
+#include "threads/thread.h"
+
+/* System-wide counters.  Per-process counters live in
+   struct thread and are updated alongside these. */
+static struct vm_stat global_stat;
+
+/* Counts a page fault that brought in a page in state STATUS
+   for the current process. */
+void vm_stat_count_fault(enum p_stat status){
+  struct vm_stat *proc = &thread_current()->vm_stat;
+  enum intr_level old_level = intr_disable();
+  switch(status){
+    case ON_SWAP:
+      global_stat.swap_fault_cnt++;
+      proc->swap_fault_cnt++;
+      break;
+    case ALL_ZERO:
+      global_stat.zero_fault_cnt++;
+      proc->zero_fault_cnt++;
+      break;
+    case FROM_FILESYS:
+      global_stat.filesys_fault_cnt++;
+      proc->filesys_fault_cnt++;
+      break;
+    case ON_FRAME:
+      break;
+  }
+  intr_set_level(old_level);
+}
+
+/* Counts one eviction of a frame owned by VICTIM.  SWEEP is the
+   number of frames the clock hand examined to find it, PIN_SKIP
+   how many of those were passed over because they were pinned.
+   The sweep is charged to the current process, which paid for it;
+   the eviction itself is charged to VICTIM. */
+void vm_stat_count_eviction(struct thread *victim, size_t sweep, size_t pin_skip){
+  struct vm_stat *proc = &thread_current()->vm_stat;
+  enum intr_level old_level = intr_disable();
+
+  global_stat.evict_cnt++;
+  global_stat.sweep_cnt += sweep;
+  global_stat.pin_skip_cnt += pin_skip;
+  if((long long) sweep > global_stat.sweep_max)
+    global_stat.sweep_max = sweep;
+
+  proc->sweep_cnt += sweep;
+  proc->pin_skip_cnt += pin_skip;
+  if((long long) sweep > proc->sweep_max)
+    proc->sweep_max = sweep;
+
+  if(victim != NULL)
+    victim->vm_stat.evict_cnt++;
+  intr_set_level(old_level);
+}
+
+/* Tracks swap slot usage: ALLOCATED is true when a slot is taken,
+   false when one is released. */
+void vm_stat_count_swap_slot(bool allocated){
+  enum intr_level old_level = intr_disable();
+  if(allocated){
+    global_stat.swap_slots_used++;
+    if(global_stat.swap_slots_used > global_stat.swap_slots_peak)
+      global_stat.swap_slots_peak = global_stat.swap_slots_used;
+  }
+  else
+    global_stat.swap_slots_used--;
+  intr_set_level(old_level);
+}
+
+/* Copies the current process's counters, or the global ones if
+   GLOBAL is true, into DST. */
+void vm_stat_get(struct vm_stat *dst, bool global){
+  enum intr_level old_level = intr_disable();
+  if(global)
+    *dst = global_stat;
+  else
+    *dst = thread_current()->vm_stat;
+  intr_set_level(old_level);
+}
+
+/* Prints VM statistics. */
+void
+vm_print_stats (void)
+{
+  printf ("VM: %lld swap faults, %lld zero faults, %lld filesys faults\n",
+          global_stat.swap_fault_cnt, global_stat.zero_fault_cnt,
+          global_stat.filesys_fault_cnt);
+  printf ("VM: %lld evictions, %lld frames swept (max %lld), "
+          "%lld pinned frames skipped\n",
+          global_stat.evict_cnt, global_stat.sweep_cnt,
+          global_stat.sweep_max, global_stat.pin_skip_cnt);
+  printf ("VM: %lld swap slots in use (peak %lld)\n",
+          global_stat.swap_slots_used, global_stat.swap_slots_peak);
+}
@@ -0,0 +1,17 @@
+#ifndef VM_STAT_H
+#define VM_STAT_H
+#include <stdbool.h>
+#include <stddef.h>
+#include <vmstat.h>
+#include "vm/page.h"
+
+struct thread;
+
+void vm_stat_count_fault(enum p_stat status);
+void vm_stat_count_eviction(struct thread *victim, size_t sweep, size_t pin_skip);
+void vm_stat_count_swap_slot(bool allocated);
+
+void vm_stat_get(struct vm_stat *dst, bool global);
+void vm_print_stats(void);
+
+#endif
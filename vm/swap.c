@@ -1,6 +1,7 @@
 #include <bitmap.h>
 
 #include "vm/swap.h"
+#include "vm/stat.h"
 #include "threads/vaddr.h"
 #include "devices/block.h"
 
@@ -25,28 +26,21 @@ void vm_swap_init(void){
 /* swap table에 mapping 된 swap disk 영역의 data를 memory로 load한다. (swap in)*/
 void vm_swap_in(swap_index_t swap_idx, void *page){
     if(!bitmap_test(available_swap, swap_idx)){
-        size_t i=0;
-        while(i < SECTORS_PER_PAGE){
-            size_t s=swap_idx * SECTORS_PER_PAGE + i;
-            void* e=page + (BLOCK_SECTOR_SIZE * i);
-            block_read(swap_block,s, e);
-            i++;
-        }
+        // page 전체를 한 번에 읽는다.
+        block_read_multi(swap_block, swap_idx * SECTORS_PER_PAGE,
+                         SECTORS_PER_PAGE, page);
         bitmap_set(available_swap, swap_idx, true);// 이제 available
+        vm_stat_count_swap_slot(false);
     }
 }
 /*page를 swap disk 에 write 하고 그 index를 반환 한다. (swap out) */
 swap_index_t vm_swap_out(void *page){
     //ASSERT(page >= PHYS_BASE);
     size_t swap_idx = bitmap_scan(available_swap, 0 , 1, true); // 가능한 region을 scan.
-    size_t i = 0;
-    while(i < SECTORS_PER_PAGE){
-        size_t e = swap_idx * SECTORS_PER_PAGE + i;
-        void* s= page+(BLOCK_SECTOR_SIZE * i);
-        block_write(swap_block,e,s );
-        i++;
-    }
+    block_write_multi(swap_block, swap_idx * SECTORS_PER_PAGE,
+                      SECTORS_PER_PAGE, page);
     bitmap_set(available_swap, swap_idx, false); // not available 표시
+    vm_stat_count_swap_slot(true);
     return swap_idx;
 }
 
@@ -56,6 +50,7 @@ void vm_swap_free(swap_index_t swap_index){
     //ASSERT(swap_index < swap_size);
     if(!bitmap_test(available_swap, swap_index)){
         bitmap_set(available_swap, swap_index, true);
+        vm_stat_count_swap_slot(false);
     }
 }
 